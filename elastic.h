@@ -0,0 +1,99 @@
+
+#ifndef ELASTIC_H
+#define ELASTIC_H
+
+#include <stddef.h>
+#include "field.h"
+
+// The transformation stresses of the variants, sig0 = lam : eps0, and their products
+// sigeps = sig0 : eps0. The transformation strains eps0 interpolate linearly between the
+// two materials via phi, so sig0 is linear and sigeps quadratic in phi at every grid point.
+// With elastic_tensors = stored they are kept as full fields (33 reals per grid point
+// with eps0), with elastic_tensors = inline only the per-material constants are kept and
+// the kernels evaluate the tensors from phi as they go.
+//
+// The kernels are templates on one of the two policies below, both give the tensors at
+// grid point ndx as s[p][ij] = sig0[p][i][j][ndx] (ij = xx, xy, yx, yy) and se[p][q] = sigeps[p][q][ndx].
+// The vectorized kernels read single components with sig() and sigeps() instead: inside an
+// omp simd loop the arrays filled by operator() have their address taken, and stay in memory.
+
+struct ElasticTensors {
+    bool stored;
+
+    // elastic_tensors = stored
+    Field4 sig0;            // sig0[p][i][j][ndx]
+    Field3 sigeps;          // sigeps[p][q][ndx]
+
+    // elastic_tensors = inline: sig0 = s_a + phi*s_b, sigeps = se_a + phi*(se_b + phi*se_c)
+    const real * phi;
+    real s_a[3][4], s_b[3][4];
+    real se_a[3][3], se_b[3][3], se_c[3][3];
+};
+
+struct StoredTensors {
+    const real * s[3][4];
+    const real * se[3][3];
+
+    StoredTensors(const ElasticTensors & el)
+    {
+        for (int p=0; p<3; p++)
+        {
+            s[p][0] = el.sig0[p][0][0];
+            s[p][1] = el.sig0[p][0][1];
+            s[p][2] = el.sig0[p][1][0];
+            s[p][3] = el.sig0[p][1][1];
+            for (int q=0; q<3; q++) se[p][q] = el.sigeps[p][q];
+        }
+    }
+
+    inline void operator() (ptrdiff_t ndx, real sig[3][4], real sigeps[3][3]) const
+    {
+        for (int p=0; p<3; p++)
+        {
+            for (int k=0; k<4; k++) sig[p][k] = s[p][k][ndx];
+            for (int q=0; q<3; q++) sigeps[p][q] = se[p][q][ndx];
+        }
+    }
+
+    inline real sig(ptrdiff_t ndx, int p, int k) const { return s[p][k][ndx]; }
+    inline real sigeps(ptrdiff_t ndx, int p, int q) const { return se[p][q][ndx]; }
+};
+
+struct InlineTensors {
+    // a copy of the constants, so they stay in registers in the kernel loops
+    const real * phi;
+    real s_a[3][4], s_b[3][4];
+    real se_a[3][3], se_b[3][3], se_c[3][3];
+
+    InlineTensors(const ElasticTensors & el) : phi(el.phi)
+    {
+        for (int p=0; p<3; p++)
+        {
+            for (int k=0; k<4; k++) { s_a[p][k] = el.s_a[p][k]; s_b[p][k] = el.s_b[p][k]; }
+            for (int q=0; q<3; q++) { se_a[p][q] = el.se_a[p][q]; se_b[p][q] = el.se_b[p][q]; se_c[p][q] = el.se_c[p][q]; }
+        }
+    }
+
+    inline void operator() (ptrdiff_t ndx, real sig[3][4], real sigeps[3][3]) const
+    {
+        const real f = phi[ndx];
+        for (int p=0; p<3; p++)
+        {
+            for (int k=0; k<4; k++) sig[p][k] = s_a[p][k] + f*s_b[p][k];
+            for (int q=0; q<3; q++) sigeps[p][q] = se_a[p][q] + f*(se_b[p][q] + f*se_c[p][q]);
+        }
+    }
+
+    inline real sig(ptrdiff_t ndx, int p, int k) const 
+    {
+        return s_a[p][k] + phi[ndx]*s_b[p][k];
+    }
+
+    inline real sigeps(ptrdiff_t ndx, int p, int q) const 
+    {
+        const real f = phi[ndx];
+        return se_a[p][q] + f*(se_b[p][q] + f*se_c[p][q]);
+    }
+};
+
+#endif
@@ -0,0 +1,125 @@
+
+#ifndef FIELD_H
+#define FIELD_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "precision.h"
+
+// Tensor fields in one contiguous block, in place of the pointer tables of kd_alloc.
+// TensorField<T, Rank> owns the block, FieldView<T, Rank> is a non-owning view (a data
+// pointer and the strides of the field) that is passed to the functions by value.
+// Indexing keeps the form of the pointer tables, sig0[p][i][j][ndx], but every [] is an
+// offset computation on the strides instead of a pointer load. A one dimensional view
+// converts to T *, so rows are addressed as eta[p] + i*N1r.
+//
+// The last index runs over the grid in the padded fftw layout (ndx = i*N1r + j) or over
+// k-space. Its extent is rounded up so that every component starts on a 64 byte boundary,
+// blocks of 2 MB and more are aligned to and advised as huge pages.
+
+const size_t field_alignment = 64;
+const size_t field_huge_page = 2*1024*1024;
+
+template <typename T, int Rank>
+class FieldView {
+    private:
+        T * m_data;
+        const ptrdiff_t * m_strides;
+
+    public:
+        FieldView() : m_data(NULL), m_strides(NULL) {}
+        FieldView(T * data, const ptrdiff_t * strides) : m_data(data), m_strides(strides) {}
+
+        FieldView<T, Rank-1> operator[] (ptrdiff_t i) const
+        {
+            return FieldView<T, Rank-1>(m_data + i*m_strides[0], m_strides + 1);
+        }
+
+        T * data() const { return m_data; }
+};
+
+template <typename T>
+class FieldView<T, 1> {
+    private:
+        T * m_data;
+
+    public:
+        FieldView() : m_data(NULL) {}
+        FieldView(T * data, const ptrdiff_t *) : m_data(data) {}
+
+        // element access goes through the conversion, v[ndx] is the built-in subscript
+        operator T * () const { return m_data; }
+        T * data() const { return m_data; }
+};
+
+template <typename T, int Rank>
+class TensorField {
+    private:
+        T * m_data;
+        size_t m_bytes;
+        ptrdiff_t m_dims[Rank];
+        ptrdiff_t m_strides[Rank];
+
+        // a field owns its block, views are passed instead of copies
+        TensorField(const TensorField &);
+        TensorField & operator= (const TensorField &);
+
+    public:
+        TensorField() : m_data(NULL), m_bytes(0) {}
+
+        template <typename... Dims>
+        explicit TensorField(Dims... dims) : m_data(NULL), m_bytes(0) { allocate(dims...); }
+
+        ~TensorField() { free(m_data); }
+
+        template <typename... Dims>
+        void allocate(Dims... dims)
+        {
+            static_assert(sizeof...(Dims) == Rank, "one extent per index");
+            static_assert(Rank >= 2, "one dimensional fields are plain arrays");
+
+            ptrdiff_t d[Rank] = {(ptrdiff_t) dims...};
+            const ptrdiff_t lanes = field_alignment/sizeof(T);
+
+            m_strides[Rank-1] = 1;
+            m_strides[Rank-2] = (d[Rank-1] + lanes - 1)/lanes*lanes;
+            for (int k=Rank-3; k>=0; k--) m_strides[k] = m_strides[k+1]*d[k+1];
+            for (int k=0; k<Rank; k++) m_dims[k] = d[k];
+
+            free(m_data);
+            m_bytes = d[0]*m_strides[0]*sizeof(T);
+
+            size_t alignment = m_bytes >= field_huge_page ? field_huge_page : field_alignment;
+            void * ptr = NULL;
+            if (posix_memalign(&ptr, alignment, m_bytes) != 0) throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (m_bytes >= field_huge_page) madvise(ptr, m_bytes, MADV_HUGEPAGE);
+#endif
+            memset(ptr, 0, m_bytes);
+            m_data = (T *) ptr;
+        }
+
+        FieldView<T, Rank> view() const { return FieldView<T, Rank>(m_data, m_strides); }
+        operator FieldView<T, Rank> () const { return view(); }
+
+        FieldView<T, Rank-1> operator[] (ptrdiff_t i) const { return view()[i]; }
+
+        T * data() const { return m_data; }
+        size_t bytes() const { return m_bytes; }
+        ptrdiff_t extent(int k) const { return m_dims[k]; }
+        ptrdiff_t stride(int k) const { return m_strides[k]; }
+};
+
+// the fields of the solver
+typedef FieldView<real, 2> Field2;
+typedef FieldView<real, 3> Field3;
+typedef FieldView<real, 4> Field4;
+
+#endif
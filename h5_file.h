@@ -4,12 +4,27 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "hdf5.h"
 
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
 class H5File {
     private:
         hid_t m_file_id;
+        hid_t m_dxpl_id;
+        bool m_parallel;
+
+        bool m_single;
+        int m_scale_digits;
+        int m_deflate;
+
+        template <typename T>
+        hid_t file_datatype();
+        hid_t create_dcpl(int ndims, hsize_t * chunk);
 
         template <typename T>
         hid_t getH5_Datatype();
@@ -23,17 +38,28 @@ class H5File {
         H5File();
 
         void open(std::string filename, std::string mode);
+        void set_storage(bool single, int scale_digits, int deflate);
+#ifdef H5_HAVE_PARALLEL
+        void open(std::string filename, std::string mode, MPI_Comm comm);
+#endif
 
         template <typename T>
         void read_dataset(std::string dataset_name, T * dataset);
+        template <typename T>
+        void read_dataset(std::string dataset_name, T * dataset, int * offset, int * count, int * mem_dims = NULL);
 
         template <typename T>
         void write_dataset(std::string dataset_name, T * dataset, int * dims, int ndims);
+        template <typename T>
+        void write_dataset(std::string dataset_name, T * dataset, int * dims, int ndims, int * offset, int * count, 
+                           int * mem_dims = NULL, int * chunk = NULL);
 
         void get_ndims(std::string dataset_name, int &ndims);
         void get_dims(std::string dataset_name, int * dims);
 
         void list(std::string path, std::vector<std::string> &list);
+        bool exists(std::string path);
+        void remove(std::string path);
         template <typename T>
         void set_attribute(std::string attr_name, T  attr_value);
         template <typename T>
@@ -62,6 +88,65 @@ hid_t H5File :: getH5_Datatype<unsigned int>() { return H5T_NATIVE_UINT; }
 
 H5File :: H5File () {
     m_file_id = 0;
+    m_dxpl_id = H5P_DEFAULT;
+    m_parallel = false;
+    m_single = false;
+    m_scale_digits = 0;
+    m_deflate = 1;
+}
+
+void H5File :: set_storage(bool single, int scale_digits, int deflate)
+{
+    /**
+    @param single store double data as 32 bit floats
+    @param scale_digits > 0 quantizes floating point data with the scale-offset filter, 
+                        keeping this many decimal digits
+    @param deflate the deflate level, 0 for no compression
+    **/
+
+    /**
+    Applies to the datasets created after the call, the data passed to write_dataset 
+    is converted by hdf5. Filters are not supported for files opened through MPI-IO, 
+    creating a dataset there with scale_digits or deflate > 0 throws.
+    */
+
+    m_single = single;
+    m_scale_digits = scale_digits;
+    m_deflate = deflate;
+}
+
+template <typename T>
+hid_t H5File :: file_datatype()
+{
+    hid_t type_id = getH5_Datatype<T>();
+    if ( m_single && H5Tequal(type_id, H5T_NATIVE_DOUBLE) > 0 ) return H5T_NATIVE_FLOAT;
+    return type_id;
+}
+
+hid_t H5File :: create_dcpl(int ndims, hsize_t * chunk)
+{
+    hid_t dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
+
+    if ( chunk ) 
+        H5Pset_chunk(dcpl_id, ndims, chunk);
+
+    if ( m_parallel && (m_scale_digits > 0 || m_deflate > 0) ) {
+        H5Pclose(dcpl_id);
+        throw Error("Filters are not supported with MPI-IO");
+    }
+
+    // the shuffle only helps the deflate, so an unfiltered format writes the same dataset both ways
+    if ( chunk && (m_scale_digits > 0 || m_deflate > 0) ) {
+        if ( m_scale_digits > 0 )
+            H5Pset_scaleoffset(dcpl_id, H5Z_SO_FLOAT_DSCALE, m_scale_digits);
+        else
+            H5Pset_shuffle(dcpl_id);
+
+        if ( m_deflate > 0 ) 
+            H5Pset_deflate(dcpl_id, m_deflate);
+    }
+
+    return dcpl_id;
 }
 
 void H5File :: create_group(std::string path)
@@ -128,6 +213,54 @@ void H5File :: open(std::string filename, std::string mode)
 
 }
 
+#ifdef H5_HAVE_PARALLEL
+void H5File :: open(std::string filename, std::string mode, MPI_Comm comm)
+{
+    /**
+    @param comm all ranks of comm open the file together through MPI-IO
+    **/
+
+    /**
+    Every call that changes the file structure (groups, datasets, attributes) 
+    is collective and must be made by all ranks of comm with the same arguments.
+    Dataset writes are collective, each rank passes its own hyperslab.
+    */
+
+    unsigned read, write, append;
+
+    read = (mode == "r");
+    write = (mode == "w");
+    append = (mode == "a");
+
+    if ( (read || write || append) != 1) 
+        throw Error("Open file with \"r\", \"w\", or \"a\" mode");
+
+    if (m_file_id != 0) 
+        throw Error("File is already open");
+
+    hid_t fapl_id = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fapl_mpio(fapl_id, comm, MPI_INFO_NULL);
+
+    if ( write )
+        m_file_id = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl_id);
+    else if ( read )
+        m_file_id = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, fapl_id);
+    else
+        m_file_id = H5Fopen(filename.c_str(), H5F_ACC_RDWR, fapl_id);
+
+    H5Pclose(fapl_id);
+
+    if (m_file_id < 0) {
+        m_file_id = 0;
+        throw Error("Error opening " + filename + " with MPI-IO");
+    }
+
+    m_dxpl_id = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(m_dxpl_id, H5FD_MPIO_COLLECTIVE);
+    m_parallel = true;
+}
+#endif
+
 template <typename T>
 void H5File :: write_dataset(std::string dataset_name, T * dataset, int * dims, int ndims)
 {
@@ -147,15 +280,12 @@ void H5File :: write_dataset(std::string dataset_name, T * dataset, int * dims,
         // convert datatypes to be compatible with hdf5
         for (int i=0; i<ndims; i++) h5_dims[i] = (hid_t) dims[i];
 
-        dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
-        H5Pset_chunk(dcpl_id, h5_ndims, h5_dims);
-        H5Pset_shuffle(dcpl_id);
-        H5Pset_deflate(dcpl_id, 1);
+        dcpl_id = create_dcpl(h5_ndims, h5_dims);
 
         space_id = H5Screate_simple(h5_ndims, h5_dims, NULL);
         data_id = H5Dcreate(m_file_id,
                             dataset_name.c_str(),
-                            getH5_Datatype<T>(),
+                            file_datatype<T>(),
                             space_id,
                             H5P_DEFAULT,
                             dcpl_id,
@@ -184,6 +314,91 @@ void H5File :: write_dataset(std::string dataset_name, T * dataset, int * dims,
 
 }
 
+template <typename T>
+void H5File :: write_dataset(std::string dataset_name, T * dataset, int * dims, int ndims, int * offset, int * count, 
+                             int * mem_dims, int * chunk)
+{
+    /**
+    @param dims the dimensions of the whole dataset in the file
+    @param offset, count the hyperslab of the file written from dataset
+    @param mem_dims the dimensions of dataset in memory, NULL if it is the count block itself
+    @param chunk the chunk shape, NULL for the default layout
+    **/
+
+    /**
+    The count block is taken from the start of dataset, so a padded buffer 
+    (mem_dims larger than count) is written without the padding and without 
+    an intermediate copy. With a file opened through MPI-IO every rank calls 
+    this with its own hyperslab and the write is collective, a rank with nothing 
+    to write passes a zero count.
+    By default the dataset is a single chunk, with MPI-IO as well, so both 
+    paths write the same layout. Filters are not supported with MPI-IO (set_storage).
+    */
+
+    hid_t data_id, file_space_id, mem_space_id;
+    herr_t error;
+
+    create_group(dataset_name);
+    htri_t dataset_exists = H5Lexists(m_file_id, dataset_name.c_str(), H5P_DEFAULT);
+
+    if ( dataset_exists )
+        throw Error("Trying to overwrite dataset " + dataset_name);
+
+    hsize_t h5_dims[ndims];
+    hsize_t h5_offset[ndims];
+    hsize_t h5_count[ndims];
+    hsize_t h5_mem_dims[ndims];
+    hsize_t h5_chunk[ndims];
+    hsize_t h5_zero[ndims];
+    hsize_t size = 1;
+
+    for (int i=0; i<ndims; i++) {
+        h5_dims[i] = (hsize_t) dims[i];
+        h5_offset[i] = (hsize_t) offset[i];
+        h5_count[i] = (hsize_t) count[i];
+        h5_mem_dims[i] = (hsize_t) (mem_dims ? mem_dims[i] : count[i]);
+        h5_chunk[i] = (hsize_t) (chunk ? std::min(chunk[i], dims[i]) : dims[i]);
+        h5_zero[i] = 0;
+        size *= h5_count[i];
+    }
+
+    hid_t dcpl_id = create_dcpl(ndims, h5_chunk);
+
+    file_space_id = H5Screate_simple(ndims, h5_dims, NULL);
+    data_id = H5Dcreate(m_file_id,
+                        dataset_name.c_str(),
+                        file_datatype<T>(),
+                        file_space_id,
+                        H5P_DEFAULT,
+                        dcpl_id,
+                        H5P_DEFAULT);
+    H5Pclose(dcpl_id);
+
+    mem_space_id = H5Screate_simple(ndims, h5_mem_dims, NULL);
+
+    if ( size > 0 ) {
+        H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET, h5_offset, NULL, h5_count, NULL);
+        H5Sselect_hyperslab(mem_space_id, H5S_SELECT_SET, h5_zero, NULL, h5_count, NULL);
+    } else {
+        H5Sselect_none(file_space_id);
+        H5Sselect_none(mem_space_id);
+    }
+
+    error = H5Dwrite(data_id,
+                     getH5_Datatype<T>(),
+                     mem_space_id,
+                     file_space_id,
+                     m_dxpl_id,
+                     dataset);
+
+    H5Sclose(mem_space_id);
+    H5Sclose(file_space_id);
+    H5Dclose(data_id);
+
+    if ( error < 0 )
+        throw Error("Error writing dataset " + dataset_name);
+}
+
 void H5File :: get_ndims(std::string dataset_name, int &ndims)
 {
     hid_t data_id, space_id;
@@ -232,6 +447,90 @@ void H5File :: read_dataset(std::string dataset_name, T * dataset)
     H5Dclose(data_id);
 }
 
+template <typename T>
+void H5File :: read_dataset(std::string dataset_name, T * dataset, int * offset, int * count, int * mem_dims)
+{
+    /**
+    @param offset, count the hyperslab of the file dataset that is read
+    @param mem_dims the dimensions of dataset in memory, NULL if it is the count block itself
+    **/
+
+    /**
+    The counterpart of the hyperslab write_dataset, the count block is placed 
+    at the start of dataset. A zero count reads nothing.
+    */
+
+    hid_t data_id, file_space_id, mem_space_id;
+    herr_t error;
+
+    data_id = H5Dopen(m_file_id, dataset_name.c_str(), H5P_DEFAULT);
+    if (data_id < 0) 
+        throw Error("Error opening dataset " + dataset_name);
+
+    file_space_id = H5Dget_space(data_id);
+    int ndims = H5Sget_simple_extent_ndims(file_space_id);
+
+    hsize_t h5_offset[ndims];
+    hsize_t h5_count[ndims];
+    hsize_t h5_mem_dims[ndims];
+    hsize_t h5_zero[ndims];
+    hsize_t size = 1;
+
+    for (int i=0; i<ndims; i++) {
+        h5_offset[i] = (hsize_t) offset[i];
+        h5_count[i] = (hsize_t) count[i];
+        h5_mem_dims[i] = (hsize_t) (mem_dims ? mem_dims[i] : count[i]);
+        h5_zero[i] = 0;
+        size *= h5_count[i];
+    }
+
+    mem_space_id = H5Screate_simple(ndims, h5_mem_dims, NULL);
+
+    if ( size > 0 ) {
+        H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET, h5_offset, NULL, h5_count, NULL);
+        H5Sselect_hyperslab(mem_space_id, H5S_SELECT_SET, h5_zero, NULL, h5_count, NULL);
+    } else {
+        H5Sselect_none(file_space_id);
+        H5Sselect_none(mem_space_id);
+    }
+
+    error = H5Dread(data_id, getH5_Datatype<T>(), mem_space_id, file_space_id, m_dxpl_id, dataset);
+
+    H5Sclose(mem_space_id);
+    H5Sclose(file_space_id);
+    H5Dclose(data_id);
+
+    if (error < 0) 
+        throw Error("Error reading dataset " + dataset_name);
+}
+
+bool H5File :: exists(std::string path)
+{
+    /**
+    @param path a group or dataset, all groups along the path are checked
+    **/
+
+    size_t pos = 0;
+    if (path[0]!='/') path = "/" + path;
+
+    while (pos != std::string::npos)
+    {
+        pos = path.find("/", pos+1);
+        if (H5Lexists(m_file_id, path.substr(0, pos).c_str(), H5P_DEFAULT) <= 0) return false;
+    }
+
+    return true;
+}
+
+void H5File :: remove(std::string path)
+{
+    /**
+    @param path the group or dataset to unlink, nothing happens if it does not exist
+    **/
+
+    if ( exists(path) ) H5Ldelete(m_file_id, path.c_str(), H5P_DEFAULT);
+}
+
 void H5File :: list(std::string path, std::vector<std::string> &list)
 {
 
@@ -338,6 +637,10 @@ void H5File :: close()
     } else {
         H5Fclose(m_file_id);
         m_file_id = 0;
+
+        if ( m_dxpl_id != H5P_DEFAULT ) H5Pclose(m_dxpl_id);
+        m_dxpl_id = H5P_DEFAULT;
+        m_parallel = false;
     }
 }
 
@@ -1,7 +1,7 @@
 
 #include "initialize.h"
 
-void initialize(double ** eta, double ** eta_old, ptrdiff_t local_n0, ptrdiff_t N1)
+void initialize(Field2 eta, Field2 eta_old, ptrdiff_t local_n0, ptrdiff_t N1)
 {
     const int N1r = 2*(N1/2+1);
     for (int i=0; i<local_n0; i++)
@@ -18,7 +18,7 @@ void initialize(double ** eta, double ** eta_old, ptrdiff_t local_n0, ptrdiff_t
     }
 }
 
-void initialize_phi_0(double * phi, ptrdiff_t local_n0, ptrdiff_t N1)
+void initialize_phi_0(real * phi, ptrdiff_t local_n0, ptrdiff_t N1)
 {
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
@@ -28,7 +28,7 @@ void initialize_phi_0(double * phi, ptrdiff_t local_n0, ptrdiff_t N1)
     }
 }
 
-void initialize_phi_1(double * phi, ptrdiff_t local_n0, ptrdiff_t N1)
+void initialize_phi_1(real * phi, ptrdiff_t local_n0, ptrdiff_t N1)
 {
     const int N1r = 2*(N1/2+1);
     for (int i=0; i<local_n0; i++)
@@ -107,7 +107,7 @@ void diffuse_lsf(double * lsf, ptrdiff_t local_n0, ptrdiff_t N1)
     }
 }
 
-void copy_lsf(double * lsf, double * phi, ptrdiff_t local_n0, ptrdiff_t N1)
+void copy_lsf(double * lsf, real * phi, ptrdiff_t local_n0, ptrdiff_t N1)
 {
     int N1r = 2*(N1/2 + 1);
 
@@ -0,0 +1,85 @@
+
+#ifndef INPUT_PARAMETERS_H
+#define INPUT_PARAMETERS_H
+
+#include <string>
+
+struct input_parameters {
+
+    int Nx, Ny;
+    int nsteps;
+    int out_freq;
+
+    double dx, dt;
+    double epsx;
+    double epsy;
+    double beta;
+    double gamma;
+    double alpha;
+    double kappa;
+    double change_etap_thresh;
+    double mu_el;
+    double nu_el;
+
+    double M0_chem_a;
+    double M0_chem_b;
+    double M0_chem_c;
+
+    double M1_chem_a;
+    double M1_chem_b;
+    double M1_chem_c;
+
+    double M0_2H_a;
+    double M0_2H_b;
+    double M0_Tp_a;
+    double M0_Tp_b;
+
+    double M1_2H_a;
+    double M1_2H_b;
+    double M1_Tp_a;
+    double M1_Tp_b;
+
+    double M0_norm;
+    double M1_norm;
+
+    std::string fftw_planner;
+    std::string fftw_wisdom_dir;
+    int fftw_wisdom;
+    int fftw_transposed;
+
+    int simd_kernels;
+    int omp_threads;
+
+    std::string relaxation;
+    int anderson_depth;
+    double anderson_mixing;
+    double fire_dt_max;
+    double semi_implicit_dt;
+    double semi_implicit_stab;
+
+    std::string elastic_tensors;
+
+    std::string w_integrator;
+    double w_dt;
+    int w_subcycles;
+
+    int parallel_io;
+    int async_output;
+    int out_chunk_x;
+    int out_chunk_y;
+    std::string out_format_eta;
+    std::string out_format_w;
+    std::string out_format_phi;
+    int out_deflate;
+    int out_displacement;
+    std::string out_format_u;
+
+    int seed;
+    int restart;
+    std::string checkpoint_file;
+    int checkpoint_freq;
+    int checkpoint_on_signal;
+    double walltime;
+};
+
+#endif
@@ -0,0 +1,299 @@
+
+#include "kernels.h"
+
+#include <cmath>
+#include <vector>
+
+// Every kernel is cloned for AVX-512, AVX2 and the baseline (SSE2 on x86-64),
+// and the loader picks the clone through the cpu detection of the ifunc resolver.
+// Where function multiversioning is not available only the baseline is built.
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GNUC__) && (!defined(__clang__) || __clang_major__ >= 14)
+#define SIMD_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#define SIMD_CLONES_BUILT
+#else
+#define SIMD_CLONES
+#endif
+
+#ifdef SIMD_CLONES_BUILT
+// one version per clone target, dispatched by the same resolver as the kernels, the call 
+// has to be in this file, elsewhere only the default version is visible
+__attribute__((target("default"))) static const char * clone_isa() { return "default"; }
+__attribute__((target("avx2"))) static const char * clone_isa() { return "avx2"; }
+__attribute__((target("avx512f"))) static const char * clone_isa() { return "avx512f"; }
+#endif
+
+const char * simd_isa()
+// the clone the loader picked for the kernels, "default" when no clones are built
+{
+#ifdef SIMD_CLONES_BUILT
+    return clone_isa();
+#else
+    return "default";
+#endif
+}
+
+SIMD_CLONES
+void calc_sig0_sigeps_simd(Field4 lam, Field4 eps0, Field4 sig0, Field3 sigeps, 
+                           ptrdiff_t local_n0, ptrdiff_t N1)
+// sig0 = lam : eps0 and sigeps = sig0 : eps0, see calc_elastic_tensors
+{
+    const int N1r = 2*(N1/2+1);
+
+    real L[2][2][2][2];
+    for (int ii=0; ii<2; ii++)
+    for (int jj=0; jj<2; jj++)
+    for (int kk=0; kk<2; kk++)
+    for (int ll=0; ll<2; ll++)
+        L[ii][jj][kk][ll] = lam[ii][jj][kk][ll];
+
+    #pragma omp parallel for
+    for (int i=0; i<local_n0; i++)
+    {
+        for (int p=0; p<3; p++)
+        {
+            const real * __restrict e00 = eps0[p][0][0] + i*N1r;
+            const real * __restrict e01 = eps0[p][0][1] + i*N1r;
+            const real * __restrict e10 = eps0[p][1][0] + i*N1r;
+            const real * __restrict e11 = eps0[p][1][1] + i*N1r;
+
+            for (int ii=0; ii<2; ii++)
+            for (int jj=0; jj<2; jj++)
+            {
+                real * __restrict s = sig0[p][ii][jj] + i*N1r;
+
+                #pragma omp simd
+                for (int j=0; j<N1; j++)
+                    s[j] = L[ii][jj][0][0]*e00[j] + L[ii][jj][0][1]*e01[j] 
+                         + L[ii][jj][1][0]*e10[j] + L[ii][jj][1][1]*e11[j];
+            }
+        }
+
+        for (int p=0; p<3; p++)
+        for (int q=0; q<3; q++)
+        {
+            const real * __restrict s00 = sig0[p][0][0] + i*N1r;
+            const real * __restrict s01 = sig0[p][0][1] + i*N1r;
+            const real * __restrict s10 = sig0[p][1][0] + i*N1r;
+            const real * __restrict s11 = sig0[p][1][1] + i*N1r;
+            const real * __restrict e00 = eps0[q][0][0] + i*N1r;
+            const real * __restrict e01 = eps0[q][0][1] + i*N1r;
+            const real * __restrict e10 = eps0[q][1][0] + i*N1r;
+            const real * __restrict e11 = eps0[q][1][1] + i*N1r;
+            real * __restrict se = sigeps[p][q] + i*N1r;
+
+            #pragma omp simd
+            for (int j=0; j<N1; j++)
+                se[j] = s00[j]*e00[j] + s01[j]*e01[j] + s10[j]*e10[j] + s11[j]*e11[j];
+        }
+    }
+}
+
+template <class Tensors>
+static inline __attribute__((always_inline))
+void chemical_potential_row(real * __restrict chem0, real * __restrict chem1, real * __restrict chem2,
+                            int i, Field2 eta, const Tensors & tensors, 
+                            Field2 epsbar, Field3 eps, 
+                            Field2 lap, real * phi, Field2 dw, 
+                            ptrdiff_t N1, const struct input_parameters & ip)
+// the chemical potential of one row, see chemical_potential in main.cc
+{
+    const int N1r = 2*(N1/2+1);
+    const int off = i*N1r;
+
+    const real * __restrict e0 = eta[0] + off;
+    const real * __restrict e1 = eta[1] + off;
+    const real * __restrict e2 = eta[2] + off;
+    const real * __restrict l0 = lap[0] + off;
+    const real * __restrict l1 = lap[1] + off;
+    const real * __restrict l2 = lap[2] + off;
+    const real * __restrict ph = phi + off;
+    const real * __restrict dx = dw[0] + off;
+    const real * __restrict dy = dw[1] + off;
+    const real * __restrict exx = eps[0][0] + off;
+    const real * __restrict exy = eps[0][1] + off;
+    const real * __restrict eyx = eps[1][0] + off;
+    const real * __restrict eyy = eps[1][1] + off;
+
+    const real eb00 = epsbar[0][0];
+    const real eb01 = epsbar[0][1];
+    const real eb10 = epsbar[1][0];
+    const real eb11 = epsbar[1][1];
+
+    const real a0 = ip.M0_chem_a, a1 = ip.M1_chem_a;
+    const real b0 = ip.M0_chem_b, b1 = ip.M1_chem_b;
+    const real c0 = ip.M0_chem_c, c1 = ip.M1_chem_c;
+    const real beta = ip.beta;
+
+    real * __restrict chem[3] = {chem0, chem1, chem2};
+    const real * __restrict lp[3] = {l0, l1, l2};
+
+    #pragma omp simd
+    for (int j=0; j<N1; j++)
+    {
+        real n[3] = {e0[j], e1[j], e2[j]};
+        real n2[3] = {n[0]*n[0], n[1]*n[1], n[2]*n[2]};
+        real eta_sum = n2[0] + n2[1] + n2[2];
+
+        real a = (1-ph[j])*a0 + ph[j]*a1;
+        real b = (1-ph[j])*b0 + ph[j]*b1;
+        real c = (1-ph[j])*c0 + ph[j]*c1;
+
+        real hxx = exx[j] + dx[j]*dx[j];
+        real hxy = exy[j] + dx[j]*dy[j];
+        real hyx = eyx[j] + dy[j]*dx[j];
+        real hyy = eyy[j] + dy[j]*dy[j];
+
+        const ptrdiff_t ndx = off + j;
+
+        for (int p=0; p<3; p++)
+        {
+            real s[4] = {tensors.sig(ndx, p, 0), tensors.sig(ndx, p, 1), tensors.sig(ndx, p, 2), tensors.sig(ndx, p, 3)};
+            real se[3] = {tensors.sigeps(ndx, p, 0), tensors.sigeps(ndx, p, 1), tensors.sigeps(ndx, p, 2)};
+
+            real f_bulk = n[p]*(a - b*n2[p] + c*eta_sum*eta_sum);
+            real f_squeeze = 2*n[p]*(se[0]*n2[0] + se[1]*n2[1] + se[2]*n2[2]);
+            real f_homo = -2*n[p]*(s[0]*eb00 + s[3]*eb11 + s[1]*eb01 + s[2]*eb10);
+            real f_hetero = -2*n[p]*(s[0]*hxx + s[1]*hxy + s[2]*hyx + s[3]*hyy);
+
+            chem[p][j] = f_bulk - beta*lp[p][j] + f_squeeze + f_homo + f_hetero;
+        }
+    }
+}
+
+SIMD_CLONES
+void calc_chemical_potential_simd(Field2 chem, Field2 eta, const ElasticTensors & el, 
+                                  Field2 epsbar, Field3 eps, 
+                                  Field2 lap, real * phi, Field2 dw, 
+                                  ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+// the parallel loop stays in the cloned function, so its outlined body is cloned with it,
+// the tensor policy is picked per row and the row kernel is inlined for both policies
+{
+    const int N1r = 2*(N1/2+1);
+
+    #pragma omp parallel for
+    for (int i=0; i<local_n0; i++)
+    {
+        if (el.stored)
+            chemical_potential_row(chem[0] + i*N1r, chem[1] + i*N1r, chem[2] + i*N1r, 
+                                   i, eta, StoredTensors(el), epsbar, eps, lap, phi, dw, N1, ip);
+        else
+            chemical_potential_row(chem[0] + i*N1r, chem[1] + i*N1r, chem[2] + i*N1r, 
+                                   i, eta, InlineTensors(el), epsbar, eps, lap, phi, dw, N1, ip);
+    }
+}
+
+SIMD_CLONES
+double update_eta_simd(Field2 eta, Field2 eta_old, const ElasticTensors & el, 
+                       Field2 epsbar, Field3 eps, 
+                       Field2 lap, real * phi, Field2 dw, double * area_count,
+                       ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+// see update_eta in main.cc, the chemical potential of a row is kept in a 
+// cache-resident row buffer and consumed by the update right away, each thread has its own
+// the parallel region stays in the cloned function like in calc_chemical_potential_simd
+{
+    const int N1r = 2*(N1/2+1);
+
+    const real dtg = 0.5*ip.dt*ip.gamma;
+    const real dtg2 = 1.0/(1.0+dtg);
+    const real dta2 = ip.dt*ip.dt*ip.alpha*ip.alpha;
+    const real threshold = 0.5*ip.M1_norm;
+
+    double change_etap_max = 0;
+    double count = 0;
+
+    #pragma omp parallel reduction(max:change_etap_max) reduction(+:count)
+    {
+        std::vector<real> row(3*N1);
+        real * chem[3] = {&row[0], &row[N1], &row[2*N1]};
+
+        #pragma omp for
+        for (int i=0; i<local_n0; i++)
+        {
+            if (el.stored)
+                chemical_potential_row(chem[0], chem[1], chem[2], 
+                                       i, eta, StoredTensors(el), epsbar, eps, lap, phi, dw, N1, ip);
+            else
+                chemical_potential_row(chem[0], chem[1], chem[2], 
+                                       i, eta, InlineTensors(el), epsbar, eps, lap, phi, dw, N1, ip);
+
+            for (int p=0; p<3; p++)
+            {
+                real * __restrict e = eta[p] + i*N1r;
+                real * __restrict eo = eta_old[p] + i*N1r;
+                const real * __restrict ch = chem[p];
+
+                #pragma omp simd reduction(max:change_etap_max) reduction(+:count)
+                for (int j=0; j<N1; j++)
+                {
+                    real eta_new = dtg2*(2*e[j] + (dtg-1)*eo[j] - dta2*ch[j]);
+                    real delta = std::fabs(eta_new - e[j]);
+                    change_etap_max = delta > change_etap_max ? delta : change_etap_max;
+
+                    eo[j] = e[j];
+                    e[j] = eta_new;
+
+                    count += std::fabs(eta_new) > threshold ? 1 : 0;
+                }
+            }
+        }
+    }
+
+    *area_count = count;
+    return change_etap_max;
+}
+
+SIMD_CLONES
+void calc_dFdw_sources_simd(real ** temp, Field2 dw, Field4 lam, Field3 eps, 
+                            Field2 epsbar, real * s0n2, ptrdiff_t local_n0, ptrdiff_t N1)
+// the real-space part of calc_dFdw, see calc_dFdw_sources in main.cc
+{
+    const int N1r = 2*(N1/2+1);
+
+    real L[2][2][2][2];
+    for (int ii=0; ii<2; ii++)
+    for (int jj=0; jj<2; jj++)
+    for (int kk=0; kk<2; kk++)
+    for (int ll=0; ll<2; ll++)
+        L[ii][jj][kk][ll] = lam[ii][jj][kk][ll];
+
+    const real eb00 = epsbar[0][0];
+    const real eb01 = epsbar[0][1];
+    const real eb10 = epsbar[1][0];
+    const real eb11 = epsbar[1][1];
+
+    #pragma omp parallel for
+    for (int i=0; i<local_n0; i++)
+    {
+        const int off = i*N1r;
+        const real * __restrict dx = dw[0] + off;
+        const real * __restrict dy = dw[1] + off;
+        const real * __restrict exx = eps[0][0] + off;
+        const real * __restrict exy = eps[0][1] + off;
+        const real * __restrict eyx = eps[1][0] + off;
+        const real * __restrict eyy = eps[1][1] + off;
+        const real * __restrict s = s0n2 + 3*off;
+        real * __restrict t0 = temp[0] + off;
+        real * __restrict t1 = temp[1] + off;
+
+        #pragma omp simd
+        for (int j=0; j<N1; j++)
+        {
+            real d[2] = {dx[j], dy[j]};
+            real e[2][2] = {{exx[j], exy[j]}, {eyx[j], eyy[j]}};
+
+            real t0j = (eb00 - s[3*j+0])*d[0] + (eb10 - s[3*j+1])*d[1];
+            real t1j = (eb01 - s[3*j+1])*d[0] + (eb11 - s[3*j+2])*d[1];
+
+            for (int ii=0; ii<2; ii++)
+            for (int kk=0; kk<2; kk++)
+            for (int ll=0; ll<2; ll++)
+            {
+                t0j += L[ii][0][kk][ll]*d[ii]*(e[ii][0] + real(0.5)*d[kk]*d[ll]);
+                t1j += L[ii][1][kk][ll]*d[ii]*(e[ii][1] + real(0.5)*d[kk]*d[ll]);
+            }
+
+            t0[j] = t0j;
+            t1[j] = t1j;
+        }
+    }
+}
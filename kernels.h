@@ -0,0 +1,34 @@
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+#include "input_parameters.h"
+#include "field.h"
+#include "elastic.h"
+
+// Explicitly vectorized versions of the real-space kernels in main.cc.
+// They work on contiguous rows of the padded local_n0 x 2*(N1/2+1) layout and
+// are compiled for several instruction sets, the best one for the running cpu 
+// is chosen when the program is loaded. The scalar versions in main.cc are 
+// kept as the reference (simd_kernels = 0). The rows are split over the OpenMP threads.
+
+const char * simd_isa();
+
+void calc_sig0_sigeps_simd(Field4 lam, Field4 eps0, Field4 sig0, Field3 sigeps, 
+                           ptrdiff_t local_n0, ptrdiff_t N1);
+
+void calc_chemical_potential_simd(Field2 chem, Field2 eta, const ElasticTensors & el, 
+                                  Field2 epsbar, Field3 eps, 
+                                  Field2 lap, real * phi, Field2 dw, 
+                                  ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip);
+
+double update_eta_simd(Field2 eta, Field2 eta_old, const ElasticTensors & el, 
+                       Field2 epsbar, Field3 eps, 
+                       Field2 lap, real * phi, Field2 dw, double * area_count,
+                       ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip);
+
+void calc_dFdw_sources_simd(real ** temp, Field2 dw, Field4 lam, Field3 eps, 
+                            Field2 epsbar, real * s0n2, ptrdiff_t local_n0, ptrdiff_t N1);
+
+#endif
@@ -2,15 +2,12 @@
 
 #include "log.h"
 
-void log_greens_function(double *** G, double ** kxy, ptrdiff_t local_n0, ptrdiff_t N1)
+void log_greens_function(Field3 G, Field2 kxy, ptrdiff_t local_nk)
 {
     FILE * fp = fopen("greens_function.dat", "w");
-    for (ptrdiff_t i=0; i<local_n0; i++)
-    for (ptrdiff_t j=0; j<N1/2+1; j++)
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
     {
-        int ndx = i*(N1/2+1) + j;
-        fprintf(fp, "%10ld", i);
-        fprintf(fp, "%10ld", j);
+        fprintf(fp, "%10ld", ndx);
         fprintf(fp, "%10.3f", kxy[0][ndx]);
         fprintf(fp, "%10.3f", kxy[1][ndx]);
         fprintf(fp, "%10.3f", G[0][0][ndx]);
@@ -22,7 +19,7 @@ void log_greens_function(double *** G, double ** kxy, ptrdiff_t local_n0, ptrdif
     fclose(fp);
 }
 
-void log_elastic_tensors(double **** lam, double **** epsT)
+void log_elastic_tensors(Field4 lam, Field4 epsT)
 {
     FILE * fp = fopen("elastic_tensors.dat","w");
     const char * f1 = "{%10.4f,%10.4f,%10.4f,%10.4f}\n";
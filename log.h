@@ -1,7 +1,7 @@
 
 
-#include <fftw3-mpi.h>
+#include "field.h"
 #include <stdio.h>
 
-void log_greens_function(double *** G, double ** kxy, ptrdiff_t local_n0, ptrdiff_t N1);
-void log_elastic_tensors(double **** lam, double **** epsT);
+void log_greens_function(Field3 G, Field2 kxy, ptrdiff_t local_nk);
+void log_elastic_tensors(Field4 lam, Field4 epsT);
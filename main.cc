@@ -1,75 +1,62 @@
 
 #include <stdio.h>
+#include <signal.h>
 
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <string>
 #include <cmath>
+#include <complex>
 #include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <stdexcept>
 
-#include <fftw3-mpi.h>
+#include "precision.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "parameter_file.h"
-#include "kd_alloc.h"
-#include "h5_file.h"
+#include "field.h"
+#include "elastic.h"
+#include "output.h"
 #include "log.h"
 #include "initialize.h"
+#include "wisdom.h"
+#include "input_parameters.h"
+#include "kernels.h"
+#include "relax.h"
+#include "scratch.h"
+#include "spectral.h"
 
 const int Re = 0;
 const int Im = 1;
 
-struct input_parameters {
-
-    int Nx, Ny;
-    int nsteps;
-    int out_freq;
-
-    double dx, dt;
-    double epsx;
-    double epsy;
-    double beta;
-    double gamma;
-    double alpha;
-    double kappa;
-    double change_etap_thresh;
-    double mu_el;
-    double nu_el;
-
-    double M0_chem_a;
-    double M0_chem_b;
-    double M0_chem_c;
-
-    double M1_chem_a;
-    double M1_chem_b;
-    double M1_chem_c;
-
-    double M0_2H_a;
-    double M0_2H_b;
-    double M0_Tp_a;
-    double M0_Tp_b;
-
-    double M1_2H_a;
-    double M1_2H_b;
-    double M1_Tp_a;
-    double M1_Tp_b;
-
-    double M0_norm;
-    double M1_norm;
-};
-
-fftw_plan planF_eta[3];
-fftw_plan planB_lap[3];
-fftw_plan planF_s0n2[3][3];
-
-fftw_plan planB_ux;
-fftw_plan planB_uy;
-
-fftw_plan plan_strain_xx;
-fftw_plan plan_strain_yy;
-fftw_plan plan_strain_xy;
-
-void calc_greens_function(double *** G, double ** kxy, ptrdiff_t local_n0, ptrdiff_t local_0_start, ptrdiff_t N1, struct input_parameters ip)
+// batched plans transform several interleaved fields with a single MPI transpose
+// the field h at grid point ndx is stored at [ndx*howmany + h]
+
+FFTW(plan) planF_eta;    // 3 fields: eta_p
+FFTW(plan) planB_lap;    // 3 fields: lap_p
+FFTW(plan) planF_s0n2;   // 3 fields: s0n2_{jk} summed over the variants
+
+FFTW(plan) planB_ux;
+FFTW(plan) planB_uy;
+
+FFTW(plan) plan_strain;   // 3 fields: eps_xx, eps_yy, eps_xy
+
+FFTW(plan) planB_dw[2];
+FFTW(plan) planB_ddw[3];
+FFTW(plan) planF_temp[2];
+FFTW(plan) planB_dFdw;
+FFTW(plan) planF_N;      // 2 fields: lam_{jklm} * dw_k * ddw_lm
+
+void calc_greens_function(Field3 G, Field2 kxy, ptrdiff_t local_n0, ptrdiff_t local_0_start, 
+                          ptrdiff_t local_n1, ptrdiff_t local_1_start, ptrdiff_t N1, struct input_parameters ip)
+// in the natural layout each process holds local_n0 rows of kx with all N1/2+1 values of ky, ndx = i*(N1/2+1) + j
+// in the transposed layout (fftw_transposed) it holds local_n1 rows of ky with all Nx values of kx, ndx = j*Nx + i
 {
     double pi = 3.14159265359;
 
@@ -80,26 +67,32 @@ void calc_greens_function(double *** G, double ** kxy, ptrdiff_t local_n0, ptrdi
     double nu = ip.nu_el;
     double radius = 4*pi/(Nx*dx)/(Ny*dx);
 
-    double * kx = new double [local_n0];
-    double * ky = new double [N1/2+1];
+    int nkx = ip.fftw_transposed ? Nx : local_n0;
+    int nky = ip.fftw_transposed ? local_n1 : N1/2+1;
+    int kx_start = ip.fftw_transposed ? 0 : local_0_start;
+    int ky_start = ip.fftw_transposed ? local_1_start : 0;
+
+    double * kx = new double [nkx];
+    double * ky = new double [nky];
 
     double Lx = Nx*dx;
     double Ly = Ny*dx;
 
-    for (int i=0; i<local_n0; i++)
+    for (int i=0; i<nkx; i++)
     {
-        int local_x = local_0_start + i;
+        int local_x = kx_start + i;
         if ( local_x < Nx/2+1 ) kx[i] = local_x * 2*pi/Lx;
         else kx[i] = (local_x - Nx) * 2*pi/Lx;
     }
 
-    for (int j=0; j<N1/2+1; j++)
-        ky[j] = j * 2*pi/Ly;
+    for (int j=0; j<nky; j++)
+        ky[j] = (ky_start + j) * 2*pi/Ly;
 
-    for (int i=0; i<local_n0; i++) 
-    for (int j=0; j<N1/2+1; j++)
+    #pragma omp parallel for
+    for (int i=0; i<nkx; i++) 
+    for (int j=0; j<nky; j++)
     {
-        int ndx = i*(N1/2+1) + j;
+        int ndx = ip.fftw_transposed ? j*nkx + i : i*nky + j;
 
         double k2 = kx[i]*kx[i] + ky[j]*ky[j];
         double norm = sqrt(k2);
@@ -139,7 +132,114 @@ void calc_greens_function(double *** G, double ** kxy, ptrdiff_t local_n0, ptrdi
     delete [] ky;
 }
 
-void calc_transformation_strains(double **** epsT, struct input_parameters ip)
+// the operators of the k-space terms, kop[op][ndx], evaluated once per k-point by calc_spectral_operators
+// the k-space loops read them instead of evaluating their symbols in every iteration
+// all of them carry the normalization 1/(N0 N1) of the inverse transform, which then needs no pass of its own
+enum { KOP_LAP,     // 2(1 - cos|k|), the symbol of minus the laplacian on the grid
+       KOP_BEND,    // kappa (kx^4 + ky^4), the bending term of dF/dw
+       KOP_SEMI,    // 1/(1 + dtg + dta2 (beta KOP_LAP + S)), the implicit eta step (relaxation = semi_implicit)
+       NKOP };
+
+inline double lap_symbol(double kx, double ky)
+{
+    double k2 = kx*kx + ky*ky;
+    double rk = (k2 >= 0.0) ? sqrt(k2) : 0.0;
+    return 2.0*(1.0-cos(rk));
+}
+
+template <class Symbol>
+void spectral_operator(real * op, Field2 kxy, ptrdiff_t local_nk, Symbol symbol)
+// op[ndx] = symbol(kx, ky) at the local k-points, a new k-space term adds its operator this way
+// the symbols are evaluated in double and rounded to real once, when they are stored
+{
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
+        op[ndx] = (real) symbol((double) kxy[0][ndx], (double) kxy[1][ndx]);
+}
+
+void calc_spectral_operators(Field2 kop, Field2 kxy, ptrdiff_t local_nk, double norm, struct input_parameters ip)
+// kxy is fixed for the run, so are the operators of the k-space terms
+// norm = 1/(N0 N1) is folded into every operator
+{
+    spectral_operator(kop[KOP_LAP], kxy, local_nk, [norm](double kx, double ky) {
+        return norm*lap_symbol(kx, ky);
+    });
+
+    double kappa = ip.kappa;
+    spectral_operator(kop[KOP_BEND], kxy, local_nk, [kappa, norm](double kx, double ky) {
+        double k4x = kx*kx*kx*kx;
+        double k4y = ky*ky*ky*ky;
+        return norm*kappa*(k4x + k4y);
+    });
+
+    if (ip.relaxation == "semi_implicit") {
+        double dt = ip.semi_implicit_dt > 0 ? ip.semi_implicit_dt : ip.dt;
+        double dtg = 0.5*dt*ip.gamma;
+        double dta2 = dt*dt*ip.alpha*ip.alpha;
+        double S = ip.semi_implicit_stab;
+        double beta = ip.beta;
+
+        spectral_operator(kop[KOP_SEMI], kxy, local_nk, [=](double kx, double ky) {
+            double kmod = lap_symbol(kx, ky);
+            return norm/(1.0 + dtg + dta2*(beta*kmod + S));
+        });
+    }
+}
+
+void calc_strain_operators(Field2 epsP, Field3 epsQ, Field3 G, Field2 kxy, ptrdiff_t local_nk, double norm)
+// the heterogeneous strain in terms of the sources of the displacement, with
+//     u = -i A ks0n2 + G kN,  A_im = sum_{j+k=m} G_ij k_k  (m = xx, xy, yy)
+//     eps = i B u,            B = (kx, 0), (ky/2, kx/2), (0, ky)  for eps_xx, eps_xy, eps_yy
+// it is eps = P ks0n2 + i Q kN with P = B A and Q = B G, both fixed for the run
+// P_em is the symmetric T_em = k_(a G_b)(j k_k) times 2 for the xy stress, which enters twice,
+// so only T is kept, epsP[n] = T_00, T_01, T_02, T_11, T_12, T_22, and epsQ[e][j] = Q_ej
+// the displacement itself is only formed where it is needed (calc_uxy_bending)
+// like the spectral operators, P and Q carry the normalization norm = 1/(N0 N1) of plan_strain
+{
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
+    {
+        double kx = kxy[0][ndx];
+        double ky = kxy[1][ndx];
+        double g[2][2] = {{G[0][0][ndx], G[0][1][ndx]}, {G[1][0][ndx], G[1][1][ndx]}};
+
+        for (int i=0; i<2; i++)
+        for (int j=0; j<2; j++)
+            g[i][j] *= norm;
+
+        double A[2][3];
+        for (int i=0; i<2; i++)
+        {
+            A[i][0] = g[i][0]*kx;
+            A[i][1] = g[i][0]*ky + g[i][1]*kx;
+            A[i][2] = g[i][1]*ky;
+        }
+
+        double P[3][3];
+        for (int m=0; m<3; m++)
+        {
+            P[0][m] = kx*A[0][m];
+            P[1][m] = 0.5*(ky*A[0][m] + kx*A[1][m]);
+            P[2][m] = ky*A[1][m];
+        }
+
+        epsP[0][ndx] = P[0][0];
+        epsP[1][ndx] = 0.5*P[0][1];
+        epsP[2][ndx] = P[0][2];
+        epsP[3][ndx] = 0.5*P[1][1];
+        epsP[4][ndx] = P[1][2];
+        epsP[5][ndx] = P[2][2];
+
+        for (int j=0; j<2; j++)
+        {
+            epsQ[0][j][ndx] = kx*g[0][j];
+            epsQ[1][j][ndx] = 0.5*(ky*g[0][j] + kx*g[1][j]);
+            epsQ[2][j][ndx] = ky*g[1][j];
+        }
+    }
+}
+
+void calc_transformation_strains(Field4 epsT, struct input_parameters ip)
 {
     const int M0 = 0;
     const int M1 = 1;
@@ -190,10 +290,8 @@ void calc_transformation_strains(double **** epsT, struct input_parameters ip)
     }
 }
 
-void calc_elastic_tensors(double **** lam, double **** eps0, double **** sig0, double *** sigeps, double mu, double nu, ptrdiff_t local_n0, ptrdiff_t N1)
+void calc_stiffness_tensor(Field4 lam, double mu, double nu)
 {
-    const int N1r = 2*(N1/2+1);
-
     double E = 2*mu*(1+nu);
     lam[0][0][0][0] = E/(1-nu*nu);
     lam[0][0][1][1] = E*nu/(1-nu*nu);
@@ -211,9 +309,22 @@ void calc_elastic_tensors(double **** lam, double **** eps0, double **** sig0, d
     lam[1][0][1][1] = 0;
     lam[1][0][0][1] = mu;
     lam[1][0][1][0] = mu;
+}
+
+void calc_elastic_tensors(Field4 lam, Field4 eps0, Field4 sig0, Field3 sigeps, ptrdiff_t local_n0, ptrdiff_t N1, bool simd)
+// sig0 = lam : eps0 and sigeps = sig0 : eps0 as full fields (elastic_tensors = stored)
+{
+    const int N1r = 2*(N1/2+1);
+
+    if (simd)
+    {
+        calc_sig0_sigeps_simd(lam, eps0, sig0, sigeps, local_n0, N1);
+        return;
+    }
 
     for (int pp=0; pp<3; pp++)
     {
+        #pragma omp parallel for
         for (int i=0; i<local_n0; i++)
         for (int j=0; j<N1; j++)
         {
@@ -234,7 +345,7 @@ void calc_elastic_tensors(double **** lam, double **** eps0, double **** sig0, d
     for (int p=0; p<3; p++)
     for (int q=0; q<3; q++)
     {
-
+        #pragma omp parallel for
         for (int i=0; i<local_n0; i++)
         for (int j=0; j<N1; j++)
         {
@@ -248,20 +359,116 @@ void calc_elastic_tensors(double **** lam, double **** eps0, double **** sig0, d
     }
 }
 
-void normalize(double * array, ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
+void calc_elastic_constants(ElasticTensors & el, Field4 lam, Field4 epsT)
+// the per-material constants of the elastic tensors (elastic_tensors = inline)
+// with eps0 = e0 + phi*de, de = e1 - e0 of the materials' epsT and s0, ds = lam : e0, lam : de
+// sig0 = s0 + phi*ds and sigeps = s0:e0 + phi*(s0:de + ds:e0) + phi^2*(ds:de) 
+{
+    double e[2][3][2][2];
+    double sm[2][3][2][2];
+
+    for (int pp=0; pp<3; pp++)
+    for (int ii=0; ii<2; ii++)
+    for (int jj=0; jj<2; jj++)
+    {
+        e[0][pp][ii][jj] = epsT[0][pp][ii][jj];
+        e[1][pp][ii][jj] = epsT[1][pp][ii][jj] - epsT[0][pp][ii][jj];
+    }
+
+    for (int m=0; m<2; m++)
+    for (int pp=0; pp<3; pp++)
+    for (int ii=0; ii<2; ii++)
+    for (int jj=0; jj<2; jj++)
+    {
+        sm[m][pp][ii][jj] = 0;
+
+        for (int kk=0; kk<2; kk++)
+        for (int ll=0; ll<2; ll++)
+            sm[m][pp][ii][jj] += lam[ii][jj][kk][ll] * e[m][pp][kk][ll];
+    }
+
+    for (int p=0; p<3; p++)
+    {
+        for (int ii=0; ii<2; ii++)
+        for (int jj=0; jj<2; jj++)
+        {
+            el.s_a[p][2*ii+jj] = sm[0][p][ii][jj];
+            el.s_b[p][2*ii+jj] = sm[1][p][ii][jj];
+        }
+
+        for (int q=0; q<3; q++)
+        {
+            double a = 0, b = 0, c = 0;
+
+            for (int ii=0; ii<2; ii++)
+            for (int jj=0; jj<2; jj++)
+            {
+                a += sm[0][p][ii][jj]*e[0][q][ii][jj];
+                b += sm[0][p][ii][jj]*e[1][q][ii][jj] + sm[1][p][ii][jj]*e[0][q][ii][jj];
+                c += sm[1][p][ii][jj]*e[1][q][ii][jj];
+            }
+
+            el.se_a[p][q] = a;
+            el.se_b[p][q] = b;
+            el.se_c[p][q] = c;
+        }
+    }
+}
+
+void unpack(real ** fields, real * batch, int howmany, ptrdiff_t N1, ptrdiff_t local_n0)
+// de-interleave the output of a batched inverse transform
+// the k-space operators before it carry the normalization, so the values are copied as they are
 {
     const int N1r = 2*(N1/2+1);
-    const double area = (double) (N0*N1);
+    #pragma omp parallel for
     for (ptrdiff_t i=0; i<local_n0; i++)
     for (ptrdiff_t j=0; j<N1; j++)
     {
         int ndx = i*N1r + j;
-        array[ndx] /= area;
+        for (int h=0; h<howmany; h++)
+            fields[h][ndx] = batch[ndx*howmany + h];
     }
 }
 
+// the noise comes from random() running on its own state array, so the generator can be checkpointed
+const int rng_size = 32;
+unsigned int rng_state[rng_size];
 
-void introduce_noise(double ** eta, ptrdiff_t local_n0, ptrdiff_t N1)
+void seed_noise(unsigned int seed)
+{
+    initstate(seed, (char *) rng_state, sizeof(rng_state));
+}
+
+void save_noise_state()
+// setstate stores the position of the running generator in rng_state (and reloads it from there),
+// so rng_state is complete for a checkpoint
+{
+    setstate((char *) rng_state);
+}
+
+void restore_noise_state(const unsigned int * saved)
+// setstate first stores the position of the running generator in its array, so the generator
+// is moved to a copy of the saved state before rng_state is overwritten
+{
+    static unsigned int copy[rng_size];
+    memcpy(copy, saved, sizeof(copy));
+    setstate((char *) copy);
+
+    memcpy(rng_state, saved, sizeof(rng_state));
+    setstate((char *) rng_state);
+}
+
+// set by SIGTERM/SIGUSR1, the run is checkpointed and stopped at the end of the load step
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+void introduce_noise(Field2 eta, real * eta_batch, ptrdiff_t local_n0, ptrdiff_t N1)
+// add random noise to the eta parameters and interleave them into eta_batch for calc_lap in the same pass
+// this loop stays serial, random() is not thread safe and the noise sequence should not depend on the thread count
 {
     const int N1r = 2*(N1/2+1);
     for (int i=0; i<local_n0; i++)
@@ -269,354 +476,483 @@ void introduce_noise(double ** eta, ptrdiff_t local_n0, ptrdiff_t N1)
     {
         int ndx = i*N1r + j;
         double r;
-        r = 2*((float)rand())/((float)RAND_MAX) - 1;
+        r = 2*((float)random())/((float)RAND_MAX) - 1;
         eta[0][ndx] += 0.003*r;
-        r = 2*((float)rand())/((float)RAND_MAX) - 1;
+        r = 2*((float)random())/((float)RAND_MAX) - 1;
         eta[1][ndx] += 0.003*r;
-        r = 2*((float)rand())/((float)RAND_MAX) - 1;
+        r = 2*((float)random())/((float)RAND_MAX) - 1;
         eta[2][ndx] += 0.003*r;
+
+        eta_batch[3*ndx+0] = eta[0][ndx];
+        eta_batch[3*ndx+1] = eta[1][ndx];
+        eta_batch[3*ndx+2] = eta[2][ndx];
     }
 }
 
-void calc_chemical_potential(double ** chem, double ** eta, double *** sigeps, 
-                             double ** epsbar, double **** sig0, double *** eps, 
-                             double ** lap, double * phi, double ** dw, 
-                             ptrdiff_t local_n0, ptrdiff_t N1, struct input_parameters ip)
+template <class Tensors>
+inline void chemical_potential(real * chem, int ndx, Field2 eta, const Tensors & tensors, 
+                               Field2 epsbar, Field3 eps, 
+                               Field2 lap, real * phi, Field2 dw, 
+                               const struct input_parameters & ip)
+// the chemical potential of the three eta parameters at grid point ndx
+// sig0[p][ij] and sigeps[p][q] are the elastic tensors at ndx, ij = xx, xy, yx, yy (elastic.h)
 {
+    real sig0[3][4], sigeps[3][3];
+    tensors(ndx, sig0, sigeps);
 
-    double EelAppl[3] = {0, 0, 0};
-    const int N1r = 2*(N1/2+1);
+    real EelAppl[3] = {0, 0, 0};
 
-    for (int i=0; i<local_n0; i++)
-    for (int j=0; j<N1; j++)
+    real f_bulk[3]    = {0,0,0};
+    real f_squeeze[3] = {0,0,0};
+    real f_homo[3]    = {0,0,0};
+    real f_hetero[3]  = {0,0,0};
+
+    real eta_sum = eta[0][ndx]*eta[0][ndx] + eta[1][ndx]*eta[1][ndx] + eta[2][ndx]*eta[2][ndx];
+
+
+    // bulk free energy
+    for (int p=0; p<3; p++)
     {
-        int ndx = i*N1r + j;
+        real eta_sq = eta[p][ndx]*eta[p][ndx];
+        real a = (1-phi[ndx])*ip.M0_chem_a + phi[ndx]*ip.M1_chem_a;
+        real b = (1-phi[ndx])*ip.M0_chem_b + phi[ndx]*ip.M1_chem_b;
+        real c = (1-phi[ndx])*ip.M0_chem_c + phi[ndx]*ip.M1_chem_c;
 
-        double f_bulk[3]    = {0,0,0};
-        double f_squeeze[3] = {0,0,0};
-        double f_homo[3]    = {0,0,0};
-        double f_hetero[3]  = {0,0,0};
+        f_bulk[p] = eta[p][ndx]*(a - b*eta_sq + c*eta_sum*eta_sum);
+    }
 
-        double eta_sum = eta[0][ndx]*eta[0][ndx] + eta[1][ndx]*eta[1][ndx] + eta[2][ndx]*eta[2][ndx];
 
+    // stress-free strain (squeeze) part of free energy (double sum)
+    for (int p=0; p<3; p++)
+    for (int q=0; q<3; q++)
+        f_squeeze[p] += 2*sigeps[p][q]*eta[p][ndx]*eta[q][ndx]*eta[q][ndx];
 
-        // bulk free energy
-        for (int p=0; p<3; p++)
-        {
-            double eta_sq = eta[p][ndx]*eta[p][ndx];
-            double a = (1-phi[ndx])*ip.M0_chem_a + phi[ndx]*ip.M1_chem_a;
-            double b = (1-phi[ndx])*ip.M0_chem_b + phi[ndx]*ip.M1_chem_b;
-            double c = (1-phi[ndx])*ip.M0_chem_c + phi[ndx]*ip.M1_chem_c;
+    // homogenous, macroscropic strain part of free energy
+    for (int p=0; p<3; p++)
+    {
+        EelAppl[p] = -2*( sig0[p][0]*epsbar[0][0]
+                        + sig0[p][3]*epsbar[1][1]
+                        + sig0[p][1]*epsbar[0][1]
+                        + sig0[p][2]*epsbar[1][0] );
+        f_homo[p] = EelAppl[p]*eta[p][ndx];
+    }
 
-            f_bulk[p] = eta[p][ndx]*(a - b*eta_sq + c*eta_sum*eta_sum);
-        }
+    // heterogenous, local strain part of free energy
+    for (int p=0; p<3; p++)
+        f_hetero[p] = -2*eta[p][ndx]* ( sig0[p][0]*(eps[0][0][ndx] + dw[0][ndx]*dw[0][ndx])
+                                      + sig0[p][1]*(eps[0][1][ndx] + dw[0][ndx]*dw[1][ndx])
+                                      + sig0[p][2]*(eps[1][0][ndx] + dw[1][ndx]*dw[0][ndx])
+                                      + sig0[p][3]*(eps[1][1][ndx] + dw[1][ndx]*dw[1][ndx]) );
 
+    for (int p=0; p<3; p++)
+    {
+        chem[p]  = f_bulk[p]; 
+        chem[p] -= ip.beta*lap[p][ndx];
+        chem[p] += f_squeeze[p] + f_homo[p] + f_hetero[p];
+    }
+}
 
-        // stress-free strain (squeeze) part of free energy (double sum)
-        for (int p=0; p<3; p++)
-        for (int q=0; q<3; q++)
-            f_squeeze[p] += 2*sigeps[p][q][ndx]*eta[p][ndx]*eta[q][ndx]*eta[q][ndx];
+template <class Tensors>
+void chemical_potential_loop(Field2 chem, Field2 eta, const Tensors & tensors, 
+                             Field2 epsbar, Field3 eps, 
+                             Field2 lap, real * phi, Field2 dw, 
+                             ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+{
+    const int N1r = 2*(N1/2+1);
 
-        // homogenous, macroscropic strain part of free energy
-        for (int p=0; p<3; p++)
-        {
-            EelAppl[p] = -2*( sig0[p][0][0][ndx]*epsbar[0][0]
-                            + sig0[p][1][1][ndx]*epsbar[1][1]
-                            + sig0[p][0][1][ndx]*epsbar[0][1]
-                            + sig0[p][1][0][ndx]*epsbar[1][0] );
-            f_homo[p] = EelAppl[p]*eta[p][ndx];
-        }
+    #pragma omp parallel for
+    for (int i=0; i<local_n0; i++)
+    for (int j=0; j<N1; j++)
+    {
+        int ndx = i*N1r + j;
+        real chem_p[3];
 
-        // heterogenous, local strain part of free energy
-        for (int p=0; p<3; p++)
-            f_hetero[p] = -2*eta[p][ndx]* ( sig0[p][0][0][ndx]*(eps[0][0][ndx] + dw[0][ndx]*dw[0][ndx])
-                                          + sig0[p][0][1][ndx]*(eps[0][1][ndx] + dw[0][ndx]*dw[1][ndx])
-                                          + sig0[p][1][0][ndx]*(eps[1][0][ndx] + dw[1][ndx]*dw[0][ndx])
-                                          + sig0[p][1][1][ndx]*(eps[1][1][ndx] + dw[1][ndx]*dw[1][ndx]) );
+        chemical_potential(chem_p, ndx, eta, tensors, epsbar, eps, lap, phi, dw, ip);
 
         for (int p=0; p<3; p++)
-        {
-            chem[p][ndx]  = f_bulk[p]; 
-            chem[p][ndx] -= ip.beta*lap[p][ndx];
-            chem[p][ndx] += f_squeeze[p] + f_homo[p] + f_hetero[p];
-        }
+            chem[p][ndx] = chem_p[p];
     }
 }
 
+void calc_chemical_potential(Field2 chem, Field2 eta, const ElasticTensors & el, 
+                             Field2 epsbar, Field3 eps, 
+                             Field2 lap, real * phi, Field2 dw, 
+                             ptrdiff_t local_n0, ptrdiff_t N1, struct input_parameters ip)
+{
+    if (el.stored)
+        chemical_potential_loop(chem, eta, StoredTensors(el), epsbar, eps, lap, phi, dw, local_n0, N1, ip);
+    else
+        chemical_potential_loop(chem, eta, InlineTensors(el), epsbar, eps, lap, phi, dw, local_n0, N1, ip);
+}
 
-///////////////////////////////////////////////////////////////////////////////////////////////
-void calc_uxy(double * ux, double * uy, fftw_complex ** ku, 
-              double *** G, double ** kxy, fftw_complex *** ks0n2, 
-              ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
-// calculate the displacements in k-space and then inverse fourier tranform to real-space
-// F{u} = G*k*F{sig0*eta^2}
-//////////////////////////////////////////////////////////////////////////////////////////////
+
+void calc_kN_lam(real * N_lam, Field4 lam, Field2 dw, Field2 ddw, ptrdiff_t local_n0, ptrdiff_t N1)
+// the source of the bending term, N_j = lam_jklm * dw_k * ddw_lm
+// lam is constant, so the contraction over k,l,m is done in real space and only 
+// the two j components are transformed (interleaved in N_lam, kN_lam through planF_N)
 {
-    const int N1c = N1/2+1;
+    const int N1r = 2*(N1/2+1);
+
+    #pragma omp parallel for
     for (int i=0; i<local_n0; i++)
-    for (int j=0; j<N1c; j++)
+    for (int j=0; j<N1; j++)
     {
-        int ndx = i*N1c + j;
+        int ndx = i*N1r + j;
 
-        for (int ii=0; ii<2; ii++)
+        for (int jj=0; jj<2; jj++)
         {
-            ku[ii][ndx][Re] = 0;
-            ku[ii][ndx][Im] = 0;
+            N_lam[2*ndx+jj] = 0;
 
-            for (int pp=0; pp<3; pp++)
-            for (int jj=0; jj<2; jj++)
             for (int kk=0; kk<2; kk++)
-            {
-                ku[ii][ndx][Re] += G[ii][jj][ndx]*kxy[kk][ndx]*ks0n2[pp][jj+kk][ndx][Im];
-                ku[ii][ndx][Im] -= G[ii][jj][ndx]*kxy[kk][ndx]*ks0n2[pp][jj+kk][ndx][Re];
-            }
+            for (int ll=0; ll<2; ll++)
+            for (int mm=0; mm<2; mm++)
+                N_lam[2*ndx+jj] += lam[jj][kk][ll][mm] * dw[kk][ndx] * ddw[ll+mm][ndx];
         }
     }
 
-    // ku -> (ux, uy)
-    fftw_execute(planB_ux);
-    fftw_execute(planB_uy);
-
-    // nomalize ux,uy - necessary after fftw
-    normalize(ux, N0, N1, local_n0);
-    normalize(uy, N0, N1, local_n0);
+    // N_lam -> kN_lam
+    FFTW(execute)(planF_N);
 }
 
-void calc_uxy_bending(double * ux, double * uy, fftw_complex ** ku, double ** dw, double ** ddw,
-                      double **** lam, double *** G, double ** kxy, fftw_complex *** ks0n2,
-                      ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
+void calc_uxy_bending(FFTW(complex) ** ku, FFTW(complex) * kN_lam, 
+                      Field3 G, Field2 kxy, FFTW(complex) * ks0n2,
+                      ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_nk)
+// the displacements with the bending term F{u_i} += G_ij * F{N_j}, kN_lam from calc_kN_lam
+// the strain does not need them, calc_eps maps the sources to the strain directly
+// ku is normalized as it is formed, planB_ux and planB_uy give the displacements ux and uy as they are
 {
-    const int N1c = N1/2+1;
-    const int N1r = 2*(N1/2+1);
+    const real norm = 1.0/((double) N0*N1);
 
-    double * N_klm = fftw_alloc_real(local_n0*N1r);
-    fftw_complex * kN_klm = fftw_alloc_complex(local_n0*N1c);
-    fftw_plan planF_N = fftw_mpi_plan_dft_r2c_2d(N0, N1, N_klm, kN_klm, MPI_COMM_WORLD, FFTW_ESTIMATE);
-
-    for (int i=0; i<local_n0; i++)
-    for (int j=0; j<N1c; j++)
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
     {
-        int ndx = i*N1c + j;
-
         for (int ii=0; ii<2; ii++)
         {
-            ku[ii][ndx][Re] = 0;
-            ku[ii][ndx][Im] = 0;
+            real re = 0;
+            real im = 0;
 
-            for (int pp=0; pp<3; pp++)
             for (int jj=0; jj<2; jj++)
             for (int kk=0; kk<2; kk++)
             {
-                ku[ii][ndx][Re] += G[ii][jj][ndx]*kxy[kk][ndx]*ks0n2[pp][jj+kk][ndx][Im];
-                ku[ii][ndx][Im] -= G[ii][jj][ndx]*kxy[kk][ndx]*ks0n2[pp][jj+kk][ndx][Re];
+                re += G[ii][jj][ndx]*kxy[kk][ndx]*ks0n2[3*ndx + jj+kk][Im];
+                im -= G[ii][jj][ndx]*kxy[kk][ndx]*ks0n2[3*ndx + jj+kk][Re];
             }
-        }
-    }
 
-    for (int kk=0; kk<2; kk++)
-    for (int ll=0; ll<2; ll++)
-    for (int mm=0; mm<2; mm++)
-    {
-        for (int i=0; i<local_n0; i++)
-        for (int j=0; j<N1r; j++)
-        {
-            int ndx = i*N1r + j;
-            N_klm[ndx] = dw[kk][ndx] * ddw[ll+mm][ndx];
-        }
-
-        fftw_execute(planF_N);
-
-        for (int i=0; i<local_n0; i++)
-        for (int j=0; j<N1c; j++)
-        {
-            int ndx = i*N1c + j;
-
-            for (int ii=0; ii<2; ii++)
             for (int jj=0; jj<2; jj++)
             {
-                ku[ii][ndx][Re] += G[ii][jj][ndx]*lam[jj][kk][ll][mm]*kN_klm[ndx][Re];
-                ku[ii][ndx][Im] += G[ii][jj][ndx]*lam[jj][kk][ll][mm]*kN_klm[ndx][Im];
+                re += G[ii][jj][ndx]*kN_lam[2*ndx+jj][Re];
+                im += G[ii][jj][ndx]*kN_lam[2*ndx+jj][Im];
             }
+
+            ku[ii][ndx][Re] = norm*re;
+            ku[ii][ndx][Im] = norm*im;
         }
     }
 
-    fftw_execute(planB_ux);
-    fftw_execute(planB_uy);
-
-    normalize(ux, N0, N1, local_n0);
-    normalize(uy, N0, N1, local_n0);
+    FFTW(execute)(planB_ux);
+    FFTW(execute)(planB_uy);
 }
 
-double update_eta(double ** eta, double ** eta_old, double ** eta_new, double ** chem, ptrdiff_t local_n0, ptrdiff_t N1, struct input_parameters ip)
+template <class Tensors>
+double update_eta_loop(Field2 eta, Field2 eta_old, const Tensors & tensors, 
+                       Field2 epsbar, Field3 eps, 
+                       Field2 lap, real * phi, Field2 dw, double * area_count,
+                       ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+// step the eta parameters in time using the evolution wave equation
+// the chemical potential, the update, the max change and the area count are done in a 
+// single sweep, so the chemical potential and the new eta are never stored as full fields
+// returns the local maximum change, area_count is the local number of transformed pixels
 {
     const int N1r = 2*(N1/2+1);
 
-    double dtg = 0.5*ip.dt*ip.gamma;
-    double dtg2 = 1.0/(1.0+dtg);
-    double dta2 = ip.dt*ip.dt*ip.alpha*ip.alpha;
+    real dtg = 0.5*ip.dt*ip.gamma;
+    real dtg2 = 1.0/(1.0+dtg);
+    real dta2 = ip.dt*ip.dt*ip.alpha*ip.alpha;
+    real threshold = 0.5*ip.M1_norm;
     double change_etap_max = 0;
+    double count = 0;
 
-    for (int p=0; p<3; p++)
+    #pragma omp parallel for reduction(max:change_etap_max) reduction(+:count)
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
         int ndx = i*N1r + j;
+        real chem[3];
 
-        eta_new[p][ndx] = dtg2*(2*eta[p][ndx] + (dtg-1)*eta_old[p][ndx] - dta2*chem[p][ndx]);
+        chemical_potential(chem, ndx, eta, tensors, epsbar, eps, lap, phi, dw, ip);
+
+        for (int p=0; p<3; p++)
+        {
+            real eta_new = dtg2*(2*eta[p][ndx] + (dtg-1)*eta_old[p][ndx] - dta2*chem[p]);
 
-        double delta = fabs( eta_new[p][ndx] - eta[p][ndx] );
-        change_etap_max = std::max(change_etap_max, delta);
+            double delta = fabs( eta_new - eta[p][ndx] );
+            change_etap_max = std::max(change_etap_max, delta);
 
-        eta_old[p][ndx] = eta[p][ndx];
-        eta[p][ndx] = eta_new[p][ndx];
+            eta_old[p][ndx] = eta[p][ndx];
+            eta[p][ndx] = eta_new;
+
+            count += std::abs(eta_new) > threshold ? 1 : 0;
+        }
     }
 
+    *area_count = count;
     return change_etap_max;
 }
 
+double update_eta(Field2 eta, Field2 eta_old, const ElasticTensors & el, 
+                  Field2 epsbar, Field3 eps, 
+                  Field2 lap, real * phi, Field2 dw, double * area_count,
+                  ptrdiff_t local_n0, ptrdiff_t N1, struct input_parameters ip)
+{
+    if (el.stored)
+        return update_eta_loop(eta, eta_old, StoredTensors(el), epsbar, eps, lap, phi, dw, area_count, local_n0, N1, ip);
+    else
+        return update_eta_loop(eta, eta_old, InlineTensors(el), epsbar, eps, lap, phi, dw, area_count, local_n0, N1, ip);
+}
 
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void calc_ks0n2(double *** s0n2, double **** sig0, double ** eta, ptrdiff_t local_n0, ptrdiff_t N1)
-// calculate and transform the nonlinear terms in the displacement equation 
-// s0n2 = sig0_{jk}(p,r) * eta^2(p)
-// sig0 = the tranformation stresses - lambda * eps0
-// eta  = orientation order parameters
-// local_n0 = size of local process in x-direction
-// N1 = size of local process in y-direction
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-{
-    const int X = 0;
-    const int Y = 1;
 
+template <class Tensors>
+void s0n2_loop(real * s0n2, const Tensors & tensors, Field2 eta, ptrdiff_t local_n0, ptrdiff_t N1)
+// s0n2 = sum_p sig0_{jk}(p,r) * eta^2(p), interleaved as s0n2[3*ndx + jk] for the batched transform
+{
     const int XX = 0;
     const int XY = 1;
     const int YY = 2;
 
     const int N1r = 2*(N1/2+1);
 
-    for (int p=0; p<3; p++)
+    #pragma omp parallel for
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
         int ndx = i*N1r + j;
-        double eta_sq = eta[p][ndx] * eta[p][ndx];
-        s0n2[p][XX][ndx] = sig0[p][X][X][ndx] * eta_sq;
-        s0n2[p][XY][ndx] = sig0[p][X][Y][ndx] * eta_sq;
-        s0n2[p][YY][ndx] = sig0[p][Y][Y][ndx] * eta_sq;
+        real sig0[3][4], sigeps[3][3];
+        tensors(ndx, sig0, sigeps);
+
+        s0n2[3*ndx + XX] = 0;
+        s0n2[3*ndx + XY] = 0;
+        s0n2[3*ndx + YY] = 0;
+
+        for (int p=0; p<3; p++)
+        {
+            real eta_sq = eta[p][ndx] * eta[p][ndx];
+            s0n2[3*ndx + XX] += sig0[p][0] * eta_sq;
+            s0n2[3*ndx + XY] += sig0[p][1] * eta_sq;
+            s0n2[3*ndx + YY] += sig0[p][3] * eta_sq;
+        }
     }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void calc_ks0n2(real * s0n2, const ElasticTensors & el, Field2 eta, ptrdiff_t local_n0, ptrdiff_t N1)
+// calculate and transform the nonlinear terms in the displacement equation 
+// s0n2 = sum_p sig0_{jk}(p,r) * eta^2(p), interleaved as s0n2[3*ndx + jk] for the batched transform
+// the displacement and dFdw only use the sum over variants, so by linearity of the 
+// fourier transform only the three stress components need to be transformed
+// el   = the tranformation stresses - lambda * eps0, stored or from phi (elastic.h)
+// eta  = orientation order parameters
+// local_n0 = size of local process in x-direction
+// N1 = size of local process in y-direction
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    if (el.stored)
+        s0n2_loop(s0n2, StoredTensors(el), eta, local_n0, N1);
+    else
+        s0n2_loop(s0n2, InlineTensors(el), eta, local_n0, N1);
 
     // s0n2 -> ks0n2
-    for (int p=0; p<3; p++)
-    for (int i=0; i<3; i++)
-        fftw_execute(planF_s0n2[p][i]);
+    FFTW(execute)(planF_s0n2);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-void calc_eps(double *** eps, fftw_complex ** keps, 
-              double ** kxy, fftw_complex ** ku, 
-              ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
+void calc_eps(Field3 eps, FFTW(complex) * keps, real * eps_batch, Field2 epsP, Field3 epsQ, 
+              FFTW(complex) * ks0n2, FFTW(complex) * kN_lam, 
+              ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_nk)
 // calculate the heterogeneous strain (delta-epsilon) in k-space and inverse tranform
+// the strain operators of calc_strain_operators take the stress source ks0n2 and the 
+// bending source kN_lam to the strain in one sweep, keps = P ks0n2 + i Q kN_lam
+// keps and eps_batch hold the three strain components interleaved for plan_strain
 ////////////////////////////////////////////////////////////////////////////////////////////
 {
-    const int X = 0;
-    const int Y = 1;
-
     const int XX = 0;
     const int YY = 1;
     const int XY = 2;
 
-    for (int i=0; i<local_n0; i++)
-    for (int j=0; j<(N1/2+1); j++)
+    // P is symmetric up to the factor 2 of the xy stress (stored as epsP, see calc_strain_operators)
+    const int sym[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+    const int slot[3] = {XX, XY, YY};
+
+    const real * P[6];
+    const real * Q[3][2];
+    for (int n=0; n<6; n++) P[n] = epsP[n];
+    for (int e=0; e<3; e++) { Q[e][0] = epsQ[e][0]; Q[e][1] = epsQ[e][1]; }
+
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
     {
-        int ndx = i*(N1/2+1) + j;
-        keps[XX][ndx][Re] = -kxy[X][ndx]*ku[X][ndx][Im];
-        keps[XX][ndx][Im] =  kxy[X][ndx]*ku[X][ndx][Re];
+        // the sources in the order xx, xy, yy, the xy stress enters twice (xy and yx)
+        real s_re[3] = {ks0n2[3*ndx+0][Re], 2*ks0n2[3*ndx+1][Re], ks0n2[3*ndx+2][Re]};
+        real s_im[3] = {ks0n2[3*ndx+0][Im], 2*ks0n2[3*ndx+1][Im], ks0n2[3*ndx+2][Im]};
+
+        for (int e=0; e<3; e++)
+        {
+            real re = 0;
+            real im = 0;
 
-        keps[YY][ndx][Re] = -kxy[Y][ndx]*ku[Y][ndx][Im];
-        keps[YY][ndx][Im] =  kxy[Y][ndx]*ku[Y][ndx][Re];
+            for (int m=0; m<3; m++)
+            {
+                re += P[sym[e][m]][ndx]*s_re[m];
+                im += P[sym[e][m]][ndx]*s_im[m];
+            }
 
-        keps[XY][ndx][Re] = -0.5*(kxy[Y][ndx]*ku[X][ndx][Im] + kxy[X][ndx]*ku[Y][ndx][Im]);
-        keps[XY][ndx][Im] =  0.5*(kxy[Y][ndx]*ku[X][ndx][Re] + kxy[X][ndx]*ku[Y][ndx][Re]);
+            for (int j=0; j<2; j++)
+            {
+                re -= Q[e][j][ndx]*kN_lam[2*ndx+j][Im];
+                im += Q[e][j][ndx]*kN_lam[2*ndx+j][Re];
+            }
+
+            keps[3*ndx+slot[e]][Re] = re;
+            keps[3*ndx+slot[e]][Im] = im;
+        }
     }
 
     // keps -> eps
-    fftw_execute(plan_strain_xx);
-    fftw_execute(plan_strain_yy);
-    fftw_execute(plan_strain_xy);
-
-    normalize(eps[0][0], N0, N1, local_n0);
-    normalize(eps[1][1], N0, N1, local_n0);
-    normalize(eps[0][1], N0, N1, local_n0);
-    std::memcpy(eps[1][0], eps[0][1], sizeof(double)*local_n0*2*(N1/2+1));
+    FFTW(execute)(plan_strain);
+
+    real * eps_comp[3] = {eps[0][0], eps[1][1], eps[0][1]};
+    unpack(eps_comp, eps_batch, 3, N1, local_n0);
+    std::memcpy(eps[1][0], eps[0][1], sizeof(real)*local_n0*2*(N1/2+1));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-void calc_lap(double ** lap, fftw_complex ** klap, fftw_complex ** keta, double ** kxy, ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
+void calc_lap(Field2 lap, real * lap_batch, FFTW(complex) * klap, FFTW(complex) * keta, 
+              real * klap_op, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_nk)
 // calculate the laplacian of the eta order paramters in k-space and inverse transform
 // the laplacian comes from the gradient squared energy term
 // it will be used to calculate the eta parameter chemical potential
+// the three variants are transformed together through the interleaved batch buffers
+// eta_batch, the input of planF_eta, is filled by introduce_noise
+// klap_op is the laplacian operator kop[KOP_LAP], normalized
 ////////////////////////////////////////////////////////////////////////////////////////////
 {
-    const int X = 0;
-    const int Y = 1;
+    // eta -> keta
+    FFTW(execute)(planF_eta);
 
-    for (int p=0; p<3; p++)
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
     {
-        // eta -> keta
-        fftw_execute(planF_eta[p]);
+        //klap[p][ndx][Re] = -k2 * keta[p][ndx][Re];
+        //klap[p][ndx][Im] = -k2 * keta[p][ndx][Im];
+        real kmod = klap_op[ndx];
 
-        for (int i=0; i<local_n0; i++)
-        for (int j=0; j<(N1/2+1); j++)
+        for (int p=0; p<3; p++)
         {
-            int ndx = i*(N1/2+1) + j;
-            double k2 = kxy[X][ndx]*kxy[X][ndx] + kxy[Y][ndx]*kxy[Y][ndx];
-            //klap[p][ndx][Re] = -k2 * keta[p][ndx][Re];
-            //klap[p][ndx][Im] = -k2 * keta[p][ndx][Im];
-
-            double rk = (k2 >= 0.0) ? sqrt(k2) : 0.0;
-            double kmod = 2.0*(1.0-cos(rk));
-            klap[p][ndx][Re] = -kmod * keta[p][ndx][Re];
-            klap[p][ndx][Im] = -kmod * keta[p][ndx][Im];
+            klap[3*ndx+p][Re] = -kmod * keta[3*ndx+p][Re];
+            klap[3*ndx+p][Im] = -kmod * keta[3*ndx+p][Im];
         }
-
-        // klap -> lap
-        fftw_execute(planB_lap[p]);
-        normalize(lap[p], N0, N1, local_n0);
     }
-}
 
+    // klap -> lap
+    FFTW(execute)(planB_lap);
+    real * lap_p[3] = {lap[0], lap[1], lap[2]};
+    unpack(lap_p, lap_batch, 3, N1, local_n0);
+}
 
-void output(std::string path, double * data, ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
+double update_eta_semi_implicit(Field2 eta, Field2 eta_old, Field2 chem, Field2 lap, 
+                                real * eta_batch, real * lap_batch, FFTW(complex) * keta, FFTW(complex) * klap, 
+                                real * ksemi, double * area_count, ptrdiff_t N0, ptrdiff_t N1, 
+                                ptrdiff_t local_n0, ptrdiff_t local_nk, struct input_parameters ip)
+// step the eta parameters with the wave equation, the gradient energy term taken at the new time level
+// chem is the full chemical potential from calc_chemical_potential, the explicit -beta*lap in it is 
+// replaced by the implicit one, which is diagonal in k-space:
+//     (1 + dtg + dta2*(beta*kmod + S)) keta_new = FFT(2 eta + (dtg-1) eta_old - dta2*(chem + beta*lap - S eta))
+// S (semi_implicit_stab) adds a linear stabilization of the bulk terms, semi_implicit_dt the larger time step
+// the transforms reuse planF_eta and planB_lap, chem is overwritten with the new eta
+// ksemi is the inverse of the implicit operator, kop[KOP_SEMI], normalized
+// returns the local maximum change, area_count is the local number of transformed pixels
 {
-    int np, rank;
-    double * buffer;
-    int alloc_local = local_n0 * (N1/2+1);
-    int tag = 0;
-    MPI_Status status;
-    int dims[2] = {N0, 2*(N1/2+1)};
+    const int N1r = 2*(N1/2+1);
 
-    MPI_Comm_size(MPI_COMM_WORLD, &np);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    real dt = ip.semi_implicit_dt > 0 ? ip.semi_implicit_dt : ip.dt;
+    real dtg = 0.5*dt*ip.gamma;
+    real dta2 = dt*dt*ip.alpha*ip.alpha;
+    real S = ip.semi_implicit_stab;
+    real threshold = 0.5*ip.M1_norm;
 
-    if ( rank == 0 ) {
-        buffer = new double [N0*2*(N1/2+1)];
-        memcpy(buffer, data, 2*alloc_local*sizeof(double));
+    // explicit right hand side -> eta_batch
+    #pragma omp parallel for
+    for (int i=0; i<local_n0; i++)
+    for (int j=0; j<N1; j++)
+    {
+        int ndx = i*N1r + j;
+        for (int p=0; p<3; p++)
+            eta_batch[3*ndx+p] = 2*eta[p][ndx] + (dtg-1)*eta_old[p][ndx] 
+                                 - dta2*(chem[p][ndx] + ip.beta*lap[p][ndx] - S*eta[p][ndx]);
+    }
 
-        for (int i=1; i<np; i++)
-            MPI_Recv(buffer + i*2*alloc_local, 2*alloc_local, MPI_DOUBLE, i, tag, MPI_COMM_WORLD, &status);
+    FFTW(execute)(planF_eta);
 
-        H5File h5;
-        h5.open("out.h5", "a");
-        h5.write_dataset(path, buffer, dims, 2);
-        h5.close();
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
+    {
+        real denom = ksemi[ndx];
 
-        delete [] buffer;
-    } else {
-        MPI_Send(data, 2*alloc_local, MPI_DOUBLE, 0, tag, MPI_COMM_WORLD);
+        for (int p=0; p<3; p++)
+        {
+            klap[3*ndx+p][Re] = denom * keta[3*ndx+p][Re];
+            klap[3*ndx+p][Im] = denom * keta[3*ndx+p][Im];
+        }
     }
 
+    FFTW(execute)(planB_lap);
+    real * eta_new[3] = {chem[0], chem[1], chem[2]};
+    unpack(eta_new, lap_batch, 3, N1, local_n0);
 
+    double change_etap_max = 0;
+    double count = 0;
+    int unstable = 0;
+
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for reduction(max:change_etap_max) reduction(+:count,unstable)
+        for (int i=0; i<local_n0; i++)
+        for (int j=0; j<N1; j++)
+        {
+            int ndx = i*N1r + j;
+            real eta_new = chem[p][ndx];
+
+            change_etap_max = std::max(change_etap_max, (double) fabs(eta_new - eta[p][ndx]));
+            count += std::abs(eta_new) > threshold ? 1 : 0;
+            unstable += std::isfinite(eta_new) ? 0 : 1;
+
+            eta_old[p][ndx] = eta[p][ndx];
+            eta[p][ndx] = eta_new;
+        }
+    }
+
+    // a max reduction drops NaNs, an unstable step is reported as an infinite change
+    *area_count = count;
+    return unstable ? HUGE_VAL : change_etap_max;
+}
+
+
+void trim_area_fraction(int step)
+// keep only the lines of area_fraction.dat up to step, when a run is restarted from a checkpoint
+{
+    std::vector<std::string> lines;
+    char line[256];
+
+    FILE * fp = fopen("area_fraction.dat", "r");
+    if (fp != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL)
+            if (atoi(line) <= step) lines.push_back(line);
+        fclose(fp);
+    }
+
+    fp = fopen("area_fraction.dat", "w");
+    for (size_t n=0; n<lines.size(); n++) fputs(lines[n].c_str(), fp);
+    fclose(fp);
 }
 
 std::string zeroFill(int x)
@@ -627,13 +963,14 @@ std::string zeroFill(int x)
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-void interpolate(double * data, double m0, double m1, double * phi, 
+void interpolate(real * data, double m0, double m1, real * phi, 
                  ptrdiff_t local_n0, ptrdiff_t N1)
 // iterpolate between values for the heterogenous composition
 ////////////////////////////////////////////////////////////////////////////////////////////
 {
     const int N1r = 2*(N1/2 + 1);
 
+    #pragma omp parallel for
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
@@ -642,11 +979,12 @@ void interpolate(double * data, double m0, double m1, double * phi,
     }
 }
 
-double calc_area(double ** eta, ptrdiff_t local_n0, ptrdiff_t N0, ptrdiff_t N1, double norm)
+double calc_area(Field2 eta, ptrdiff_t local_n0, ptrdiff_t N0, ptrdiff_t N1, double norm)
 {
     const int N1r = 2*(N1/2+1);
     double sum = 0;
     double threshold = 0.5*norm;
+    #pragma omp parallel for reduction(+:sum)
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
@@ -720,9 +1058,10 @@ void calc_dw(double ** dw, double * w, ptrdiff_t local_n0, ptrdiff_t N1, double
 }
 */
 
-double max ( double * data, int local_n0, int N1 )
+double max ( real * data, int local_n0, int N1 )
 {
     double m = 0;
+    #pragma omp parallel for reduction(max:m)
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
@@ -732,7 +1071,13 @@ double max ( double * data, int local_n0, int N1 )
     return m;
 }
 
-void calc_dw(double * w, double ** dw, double ** ddw, double ** kxy, ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0)
+///////////////////////////////////////////////////////////////////////////////////////////////
+void calc_dw(Field2 dw, Field2 ddw, SpectralField & w, FFTW(complex) ** kdw, FFTW(complex) ** kddw, 
+             Field2 kxy, ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_nk)
+// calculate the first and second derivatives of the out-of-plane displacement in k-space
+// kw is the cached transform of w, then kdw -> dw and kddw -> ddw through planB_dw, planB_ddw
+// the derivatives are normalized in k-space, the inverse transforms give them as they are
+///////////////////////////////////////////////////////////////////////////////////////////////
 {
     const int X = 0;
     const int Y = 1;
@@ -740,114 +1085,58 @@ void calc_dw(double * w, double ** dw, double ** ddw, double ** kxy, ptrdiff_t N
     const int XY = 1;
     const int YY = 2;
 
-    const int N1c = N1/2+1;
-
-    fftw_complex * kw = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * kdwx = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * kdwy = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * kddwxx = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * kddwxy = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * kddwyy = fftw_alloc_complex(local_n0*N1c);
-
-    fftw_plan planF_w = fftw_mpi_plan_dft_r2c_2d(N0, N1, w, kw, MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planB_kdwx = fftw_mpi_plan_dft_c2r_2d(N0, N1, kdwx, dw[X], MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planB_kdwy = fftw_mpi_plan_dft_c2r_2d(N0, N1, kdwy, dw[Y], MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planB_kddwxx = fftw_mpi_plan_dft_c2r_2d(N0, N1, kddwxx, ddw[XX], MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planB_kddwxy = fftw_mpi_plan_dft_c2r_2d(N0, N1, kddwxy, ddw[XY], MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planB_kddwyy = fftw_mpi_plan_dft_c2r_2d(N0, N1, kddwyy, ddw[YY], MPI_COMM_WORLD, FFTW_ESTIMATE);
+    FFTW(complex) * kdwx = kdw[X];
+    FFTW(complex) * kdwy = kdw[Y];
+    FFTW(complex) * kddwxx = kddw[XX];
+    FFTW(complex) * kddwxy = kddw[XY];
+    FFTW(complex) * kddwyy = kddw[YY];
 
-    fftw_execute(planF_w);
+    const real norm = 1.0/((double) N0*N1);
+    const FFTW(complex) * kw = w.transform();
 
-    for (int i=0; i<local_n0; i++)
-    for (int j=0; j<N1c; j++)
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
     {
-        int ndx = i*N1c + j;
+        real kw_re = norm*kw[ndx][Re];
+        real kw_im = norm*kw[ndx][Im];
 
-        kdwx[ndx][Re] = -kxy[X][ndx] * kw[ndx][Im];
-        kdwx[ndx][Im] =  kxy[X][ndx] * kw[ndx][Re];
+        kdwx[ndx][Re] = -kxy[X][ndx] * kw_im;
+        kdwx[ndx][Im] =  kxy[X][ndx] * kw_re;
 
-        kdwy[ndx][Re] = -kxy[Y][ndx] * kw[ndx][Im];
-        kdwy[ndx][Im] =  kxy[Y][ndx] * kw[ndx][Re];
+        kdwy[ndx][Re] = -kxy[Y][ndx] * kw_im;
+        kdwy[ndx][Im] =  kxy[Y][ndx] * kw_re;
 
-        kddwxx[ndx][Re] = -kxy[X][ndx]*kxy[X][ndx] * kw[ndx][Re];
-        kddwxx[ndx][Im] = -kxy[X][ndx]*kxy[X][ndx] * kw[ndx][Im];
+        kddwxx[ndx][Re] = -kxy[X][ndx]*kxy[X][ndx] * kw_re;
+        kddwxx[ndx][Im] = -kxy[X][ndx]*kxy[X][ndx] * kw_im;
  
-        kddwyy[ndx][Re] = -kxy[Y][ndx]*kxy[Y][ndx] * kw[ndx][Re];
-        kddwyy[ndx][Im] = -kxy[Y][ndx]*kxy[Y][ndx] * kw[ndx][Im];
+        kddwyy[ndx][Re] = -kxy[Y][ndx]*kxy[Y][ndx] * kw_re;
+        kddwyy[ndx][Im] = -kxy[Y][ndx]*kxy[Y][ndx] * kw_im;
 
-        kddwxy[ndx][Re] = -kxy[X][ndx]*kxy[Y][ndx] * kw[ndx][Re];
-        kddwxy[ndx][Im] = -kxy[X][ndx]*kxy[Y][ndx] * kw[ndx][Im];
+        kddwxy[ndx][Re] = -kxy[X][ndx]*kxy[Y][ndx] * kw_re;
+        kddwxy[ndx][Im] = -kxy[X][ndx]*kxy[Y][ndx] * kw_im;
     }
 
-    fftw_execute(planB_kdwx);
-    fftw_execute(planB_kdwy);
-    fftw_execute(planB_kddwxx);
-    fftw_execute(planB_kddwxy);
-    fftw_execute(planB_kddwyy);
-
-    normalize(dw[X], N0, N1, local_n0);
-    normalize(dw[Y], N0, N1, local_n0);
-    normalize(ddw[XX], N0, N1, local_n0);
-    normalize(ddw[XY], N0, N1, local_n0);
-    normalize(ddw[YY], N0, N1, local_n0);
-
-    fftw_destroy_plan(planF_w);
-    fftw_destroy_plan(planB_kdwx);
-    fftw_destroy_plan(planB_kdwy);
-    fftw_destroy_plan(planB_kddwxx);
-    fftw_destroy_plan(planB_kddwxy);
-    fftw_destroy_plan(planB_kddwyy);
-
-    fftw_free(kw);
-    fftw_free(kdwx);
-    fftw_free(kdwy);
-    fftw_free(kddwxx);
-    fftw_free(kddwxy);
-    fftw_free(kddwyy);
+    FFTW(execute)(planB_dw[X]);
+    FFTW(execute)(planB_dw[Y]);
+    FFTW(execute)(planB_ddw[XX]);
+    FFTW(execute)(planB_ddw[XY]);
+    FFTW(execute)(planB_ddw[YY]);
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
-void calc_dFdw(double * dFdw, double * w, double ** dw, 
-               double **** lam, double *** eps, double ** epsbar, double *** s0n2, double ** kxy, 
-               ptrdiff_t local_n0, ptrdiff_t N0, ptrdiff_t N1, double kappa)
-// Calculate the chemical potentail of the out-of-plane displacement that will be used for evolution
-
-// dFdw[ndx] is the variational derivative (chemical potential) of the out-of-plane displacement
-// w[ndx], dw[i][ndx] are the out-of-plane displacements and its first derivatives
-// lam[i][j][k][l] is the elastic stiffness tensor (lambda)
-// eps[i][j][ndx] is the heterogeneous strain 0.5(u_{ij} + u_{ji})
-// epsbar[i][ndx] is the homogeneous strain on the system
-// s0n2[p][ij][ndx] is the product sig0(p,r) * eta(p) 
-// kxy[i][ndx] are the k-vectors for calculating derivatives in k-space
-// kappa is the bending modulus
+void calc_dFdw_sources(real ** temp, Field2 dw, Field4 lam, Field3 eps, 
+                       Field2 epsbar, real * s0n2, ptrdiff_t local_n0, ptrdiff_t N1)
+// the real-space part of calc_dFdw, the in-plane stress contracted with dw
+// see calc_dFdw_sources_simd in kernels.cc for the vectorized version
 ///////////////////////////////////////////////////////////////////////////////////////////////
 {
-    const int N1c = N1/2 + 1;
     const int N1r = 2*(N1/2+1);
 
-    const int X = 0;
-    const int Y = 1;
-
-    // allocate temporary memory
-    double * temp0 = fftw_alloc_real(local_n0*N1r);
-    double * temp1 = fftw_alloc_real(local_n0*N1r);
-
-    fftw_complex * ktemp0 = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * ktemp1 = fftw_alloc_complex(local_n0*N1c);
+    real * temp0 = temp[0];
+    real * temp1 = temp[1];
 
-    fftw_complex * kdFdw  = fftw_alloc_complex(local_n0*N1c);
-    fftw_complex * kw     = fftw_alloc_complex(local_n0*N1c);
-
-    // initialize fast fourier transforms
-
-    fftw_plan planF_temp0 = fftw_mpi_plan_dft_r2c_2d(N0, N1, temp0, ktemp0, MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planF_temp1 = fftw_mpi_plan_dft_r2c_2d(N0, N1, temp1, ktemp1, MPI_COMM_WORLD, FFTW_ESTIMATE);
-    fftw_plan planF_w    = fftw_mpi_plan_dft_r2c_2d(N0, N1, w, kw, MPI_COMM_WORLD, FFTW_ESTIMATE);
-
-    fftw_plan planB_dFdw = fftw_mpi_plan_dft_c2r_2d(N0, N1, kdFdw, dFdw, MPI_COMM_WORLD, FFTW_ESTIMATE);
-
-    // do some of the calculations in real space before taking derivatives
+    #pragma omp parallel for
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
@@ -857,8 +1146,8 @@ void calc_dFdw(double * dFdw, double * w, double ** dw,
 
         for (int ii=0; ii<2; ii++)
         {
-            temp0[ndx] += (epsbar[ii][0] - s0n2[0][ii+0][ndx] - s0n2[1][ii+0][ndx] - s0n2[2][ii+0][ndx])*dw[ii][ndx];
-            temp1[ndx] += (epsbar[ii][1] - s0n2[0][ii+1][ndx] - s0n2[1][ii+1][ndx] - s0n2[2][ii+1][ndx])*dw[ii][ndx];
+            temp0[ndx] += (epsbar[ii][0] - s0n2[3*ndx+ii+0])*dw[ii][ndx];
+            temp1[ndx] += (epsbar[ii][1] - s0n2[3*ndx+ii+1])*dw[ii][ndx];
         }
 
         for (int ii=0; ii<2; ii++)
@@ -869,68 +1158,184 @@ void calc_dFdw(double * dFdw, double * w, double ** dw,
             temp1[ndx] += lam[ii][1][kk][ll]*dw[ii][ndx]*(eps[ii][1][ndx] + 0.5*dw[kk][ndx]*dw[ll][ndx]);
         }
     }
+}
+
+
+void transform_dFdw_sources(real ** temp, Field2 dw, Field4 lam, Field3 eps, Field2 epsbar, 
+                            real * s0n2, ptrdiff_t local_n0, ptrdiff_t N1, bool simd)
+// the real-space part of the w chemical potential and the forward transforms temp -> ktemp
+// shared by calc_dFdw and the exponential integrator step_w_etd, which take kw from the cache
+{
+    // do some of the calculations in real space before taking derivatives
+    if (simd)
+        calc_dFdw_sources_simd(temp, dw, lam, eps, epsbar, s0n2, local_n0, N1);
+    else
+        calc_dFdw_sources(temp, dw, lam, eps, epsbar, s0n2, local_n0, N1);
 
     // forward tranform to k-space
-    fftw_execute(planF_temp0);
-    fftw_execute(planF_temp1);
-    fftw_execute(planF_w);
+    FFTW(execute)(planF_temp[0]);
+    FFTW(execute)(planF_temp[1]);
+}
 
-    // calculate the derivatives in k-space
-    for (int i=0; i<local_n0; i++)
-    for (int j=0; j<N1c; j++)
-    {
-        int ndx = i*N1c + j;
-        double k4x = kxy[X][ndx]*kxy[X][ndx]*kxy[X][ndx]*kxy[X][ndx];
-        double k4y = kxy[Y][ndx]*kxy[Y][ndx]*kxy[Y][ndx]*kxy[Y][ndx];
+///////////////////////////////////////////////////////////////////////////////////////////////
+void calc_dFdw(real * dFdw, Field2 dw, real ** temp, FFTW(complex) ** ktemp, 
+               FFTW(complex) * kdFdw, SpectralField & w,
+               Field4 lam, Field3 eps, Field2 epsbar, real * s0n2, Field2 kxy, 
+               real * kbend, ptrdiff_t local_n0, ptrdiff_t local_nk, ptrdiff_t N0, ptrdiff_t N1, bool simd)
+// Calculate the chemical potentail of the out-of-plane displacement that will be used for evolution
 
-        kdFdw[ndx][Re] =  kxy[X][ndx]*ktemp0[ndx][Im] + kxy[Y][ndx]*ktemp1[ndx][Im] + kappa*(k4x + k4y)*kw[ndx][Re];
-        kdFdw[ndx][Im] = -kxy[X][ndx]*ktemp0[ndx][Re] - kxy[Y][ndx]*ktemp1[ndx][Re] + kappa*(k4x + k4y)*kw[ndx][Im];
+// dFdw[ndx] is the variational derivative (chemical potential) of the out-of-plane displacement
+// dw[i][ndx] are the first derivatives of the out-of-plane displacement
+// temp[i], ktemp[i], kdFdw are workspace buffers bound to planF_temp and planB_dFdw
+// w is the out-of-plane displacement, its transform kw is shared with calc_dw (spectral.h)
+// lam[i][j][k][l] is the elastic stiffness tensor (lambda)
+// eps[i][j][ndx] is the heterogeneous strain 0.5(u_{ij} + u_{ji})
+// epsbar[i][ndx] is the homogeneous strain on the system
+// s0n2[3*ndx + ij] is the product sig0(p,r) * eta(p) summed over the variants p
+// kxy[i][ndx] are the k-vectors for calculating derivatives in k-space
+// kbend is the bending operator kappa*(kx^4 + ky^4), kop[KOP_BEND], normalized like kdFdw
+// simd selects the vectorized real-space kernel from kernels.cc
+///////////////////////////////////////////////////////////////////////////////////////////////
+{
+    const int X = 0;
+    const int Y = 1;
+
+    FFTW(complex) * ktemp0 = ktemp[0];
+    FFTW(complex) * ktemp1 = ktemp[1];
+
+    // temp -> ktemp, kw from the cache
+    transform_dFdw_sources(temp, dw, lam, eps, epsbar, s0n2, local_n0, N1, simd);
+    const FFTW(complex) * kw = w.transform();
+
+    // calculate the derivatives in k-space, normalized for planB_dFdw
+    const real norm = 1.0/((double) N0*N1);
+
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
+    {
+        kdFdw[ndx][Re] =  norm*(kxy[X][ndx]*ktemp0[ndx][Im] + kxy[Y][ndx]*ktemp1[ndx][Im]) + kbend[ndx]*kw[ndx][Re];
+        kdFdw[ndx][Im] = -norm*(kxy[X][ndx]*ktemp0[ndx][Re] + kxy[Y][ndx]*ktemp1[ndx][Re]) + kbend[ndx]*kw[ndx][Im];
     }
 
     // inverse fourier transform kdFdw -> dFdw
-    fftw_execute(planB_dFdw); 
-
-    normalize(dFdw, N0, N1, local_n0);
-
-    // free memory
-    fftw_free(temp0);
-    fftw_free(temp1);
-    fftw_free(ktemp0);
-    fftw_free(ktemp1);
-    fftw_free(kdFdw);
-    fftw_free(kw);
-
-    fftw_destroy_plan(planF_w);
-    fftw_destroy_plan(planF_temp0);
-    fftw_destroy_plan(planF_temp1);
-    fftw_destroy_plan(planB_dFdw);
+    FFTW(execute)(planB_dFdw); 
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void update_w(double * w, double * w_old, double * w_new, double * dFdw, ptrdiff_t local_n0, ptrdiff_t N1, struct input_parameters ip)
+void update_w(real * w, real * w_old, real * dFdw, ptrdiff_t local_n0, ptrdiff_t N1, struct input_parameters ip)
 // step the out-of-plane displacement in time using the evolution wave equation
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 {
     const int N1r = 2*(N1/2+1);
-    double dtw = ip.dt/20.0;
+    real dtw = ip.w_dt > 0 ? ip.w_dt : ip.dt/20.0;
 
-    double dtg = 0.5*dtw*ip.gamma;
-    double dtg2 = 1.0/(1.0+dtg);
-    double dta2 = dtw*dtw*ip.alpha*ip.alpha;
+    real dtg = 0.5*dtw*ip.gamma;
+    real dtg2 = 1.0/(1.0+dtg);
+    real dta2 = dtw*dtw*ip.alpha*ip.alpha;
 
+    #pragma omp parallel for
     for (int i=0; i<local_n0; i++)
     for (int j=0; j<N1; j++)
     {
         int ndx = i*N1r + j;
 
-        w_new[ndx] = dtg2*(2*w[ndx] + (dtg-1)*w_old[ndx] - dta2*dFdw[ndx]);
+        real w_new = dtg2*(2*w[ndx] + (dtg-1)*w_old[ndx] - dta2*dFdw[ndx]);
 
         w_old[ndx] = w[ndx];
-        w[ndx] = w_new[ndx];
+        w[ndx] = w_new;
     }
 }
 
-void add_w_noise(double * w, ptrdiff_t local_n0, ptrdiff_t N1)
+std::complex<double> phi1(std::complex<double> z)
+// (exp(z) - 1)/z, with the series close to z = 0
+{
+    if (std::abs(z) < 1e-3) return 1.0 + z*(1.0/2 + z*(1.0/6 + z/24.0));
+    return (std::exp(z) - 1.0)/z;
+}
+
+double init_w_etd(real * etd_c1, real * etd_b, Field2 kxy, ptrdiff_t local_nk, double norm, struct input_parameters ip)
+// coefficients of the exponential integrator for w, see step_w_etd
+// per mode w_tt + gamma w_t + omega^2 w = -alpha^2 N with omega^2 = alpha^2 kappa (kx^4 + ky^4) 
+// and the roots s1, s2 of s^2 + gamma s + omega^2, for N constant over the step h the recurrence
+//     w_new = c1 w - c2 w_old - alpha^2 b N,   c1 = exp(s1 h) + exp(s2 h),  c2 = exp(-gamma h),
+//                                              b = h^2 phi1(s1 h) phi1(s2 h)
+// is exact, so the bending operator no longer limits h, returns c2 which is the same for all modes
+// c1 and b carry the normalization norm = 1/(N0 N1) of the inverse transform in step_w_etd
+{
+    const int X = 0;
+    const int Y = 1;
+    double h = ip.w_dt > 0 ? ip.w_dt : ip.dt/20.0;
+
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
+    {
+        double k4x = kxy[X][ndx]*kxy[X][ndx]*kxy[X][ndx]*kxy[X][ndx];
+        double k4y = kxy[Y][ndx]*kxy[Y][ndx]*kxy[Y][ndx]*kxy[Y][ndx];
+        double omega2 = ip.alpha*ip.alpha*ip.kappa*(k4x + k4y);
+
+        std::complex<double> root = std::sqrt(std::complex<double>(0.25*ip.gamma*ip.gamma - omega2, 0.0));
+        std::complex<double> s1 = -0.5*ip.gamma + root;
+        std::complex<double> s2 = -0.5*ip.gamma - root;
+
+        etd_c1[ndx] = norm*std::real(std::exp(s1*h) + std::exp(s2*h));
+        etd_b[ndx] = norm*h*h*std::real(phi1(s1*h)*phi1(s2*h));
+    }
+
+    return exp(-ip.gamma*h);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+void step_w_etd(SpectralField & w, real * w_old, real * w_new, Field2 dw, real ** temp, FFTW(complex) ** ktemp, 
+                FFTW(complex) * kw_new, real * etd_c1, real * etd_b, double etd_c2, 
+                Field4 lam, Field3 eps, Field2 epsbar, real * s0n2, Field2 kxy, 
+                ptrdiff_t local_n0, ptrdiff_t local_nk, ptrdiff_t N0, ptrdiff_t N1, struct input_parameters ip)
+// step the out-of-plane displacement with the exponential integrator, in place of calc_dFdw and update_w
+// the bending term is integrated exactly (init_w_etd), only the stress term N is taken from the current w
+// c2 is the same for all modes, so w_old stays in real space:
+//     w_new = IFFT(c1 kw - alpha^2 b kN) - c2 w_old
+// kw_new and w_new are the kdFdw and dFdw buffers bound to planB_dFdw, kw comes from the cache
+///////////////////////////////////////////////////////////////////////////////////////////////
+{
+    const int X = 0;
+    const int Y = 1;
+    const int N1r = 2*(N1/2+1);
+    const real a2 = ip.alpha*ip.alpha;
+
+    FFTW(complex) * ktemp0 = ktemp[0];
+    FFTW(complex) * ktemp1 = ktemp[1];
+
+    // temp -> ktemp, kw from the cache
+    transform_dFdw_sources(temp, dw, lam, eps, epsbar, s0n2, local_n0, N1, ip.simd_kernels);
+    const FFTW(complex) * kw = w.transform();
+
+    #pragma omp parallel for
+    for (ptrdiff_t ndx=0; ndx<local_nk; ndx++)
+    {
+        real kN_re =  kxy[X][ndx]*ktemp0[ndx][Im] + kxy[Y][ndx]*ktemp1[ndx][Im];
+        real kN_im = -kxy[X][ndx]*ktemp0[ndx][Re] - kxy[Y][ndx]*ktemp1[ndx][Re];
+
+        kw_new[ndx][Re] = etd_c1[ndx]*kw[ndx][Re] - a2*etd_b[ndx]*kN_re;
+        kw_new[ndx][Im] = etd_c1[ndx]*kw[ndx][Im] - a2*etd_b[ndx]*kN_im;
+    }
+
+    // kw_new -> w_new, normalized through c1 and b
+    FFTW(execute)(planB_dFdw);
+
+    real * wr = w.r;
+
+    #pragma omp parallel for
+    for (int i=0; i<local_n0; i++)
+    for (int j=0; j<N1; j++)
+    {
+        int ndx = i*N1r + j;
+        real wn = w_new[ndx] - etd_c2*w_old[ndx];
+
+        w_old[ndx] = wr[ndx];
+        wr[ndx] = wn;
+    }
+}
+
+void add_w_noise(real * w, ptrdiff_t local_n0, ptrdiff_t N1)
 {
     const int N1r = 2*(N1/2+1);
     double epdt2 = 0.00004;
@@ -939,7 +1344,7 @@ void add_w_noise(double * w, ptrdiff_t local_n0, ptrdiff_t N1)
     for (int j=0; j<N1; j++)
     {
         int ndx = i*N1r + j;
-        double rnum = rand() / (double) RAND_MAX;
+        double rnum = random() / (double) RAND_MAX;
         rnum = 2*rnum - 1;
         w[ndx] = w[ndx] + epdt2*rnum;
     }
@@ -948,10 +1353,16 @@ void add_w_noise(double * w, ptrdiff_t local_n0, ptrdiff_t N1)
 int main(int argc, char ** argv)
 {
 
-    MPI_Init(&argc, &argv);
-    fftw_mpi_init();
+    // the threads of the fftw plans and the OpenMP loops work between the MPI calls of the 
+    // master thread, only the asynchronous output thread makes MPI calls of its own
+    int thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &thread_support);
+#ifdef _OPENMP
+    FFTW(init_threads)();
+#endif
+    FFTW(mpi_init)();
 
-    srand(time(NULL));
+    double start_time = MPI_Wtime();
 
     struct input_parameters ip;
 
@@ -997,141 +1408,307 @@ int main(int argc, char ** argv)
     pf.unpack("M0_norm", ip.M0_norm);
     pf.unpack("M1_norm", ip.M1_norm);
 
-    ptrdiff_t local_n0;
-    ptrdiff_t local_0_start;
+    pf.unpack("fftw_planner", ip.fftw_planner, std::string("measure"));
+    pf.unpack("fftw_wisdom", ip.fftw_wisdom, 0);
+    pf.unpack("fftw_wisdom_dir", ip.fftw_wisdom_dir, std::string("."));
+    pf.unpack("fftw_transposed", ip.fftw_transposed, 0);
+    pf.unpack("simd_kernels", ip.simd_kernels, 1);
+    pf.unpack("omp_threads", ip.omp_threads, 0);
+    pf.unpack("relaxation", ip.relaxation, std::string("wave"));
+    pf.unpack("anderson_depth", ip.anderson_depth, 5);
+    pf.unpack("anderson_mixing", ip.anderson_mixing, 1.0);
+    pf.unpack("fire_dt_max", ip.fire_dt_max, 10.0);
+    pf.unpack("semi_implicit_dt", ip.semi_implicit_dt, 0.0);
+    pf.unpack("semi_implicit_stab", ip.semi_implicit_stab, 0.0);
+    pf.unpack("elastic_tensors", ip.elastic_tensors, std::string("stored"));
+    pf.unpack("w_integrator", ip.w_integrator, std::string("wave"));
+    pf.unpack("w_dt", ip.w_dt, 0.0);
+    pf.unpack("w_subcycles", ip.w_subcycles, 1);
+
+    if (ip.anderson_depth < 1)
+        throw std::runtime_error("anderson_depth must be at least 1: " + std::to_string(ip.anderson_depth));
+    if (ip.elastic_tensors != "stored" && ip.elastic_tensors != "inline")
+        throw std::runtime_error("Unknown elastic_tensors: " + ip.elastic_tensors);
+    if (ip.w_integrator != "wave" && ip.w_integrator != "etd")
+        throw std::runtime_error("Unknown w_integrator: " + ip.w_integrator);
+    pf.unpack("parallel_io", ip.parallel_io, 1);
+    pf.unpack("async_output", ip.async_output, 1);
+    pf.unpack("out_chunk_x", ip.out_chunk_x, 0);
+    pf.unpack("out_chunk_y", ip.out_chunk_y, 0);
+    pf.unpack("out_format_eta", ip.out_format_eta, std::string("double"));
+    pf.unpack("out_format_w", ip.out_format_w, std::string("double"));
+    pf.unpack("out_format_phi", ip.out_format_phi, std::string("double"));
+    pf.unpack("out_deflate", ip.out_deflate, 1);
+    pf.unpack("out_displacement", ip.out_displacement, 0);
+    pf.unpack("out_format_u", ip.out_format_u, std::string("double"));
+
+    pf.unpack("seed", ip.seed, 0);
+    pf.unpack("restart", ip.restart, 0);
+    pf.unpack("checkpoint_file", ip.checkpoint_file, std::string("checkpoint.h5"));
+    pf.unpack("checkpoint_freq", ip.checkpoint_freq, 0);
+    pf.unpack("checkpoint_on_signal", ip.checkpoint_on_signal, 1);
+    pf.unpack("walltime", ip.walltime, 0.0);
+
+    // seed = 0 seeds the noise from the clock
+    seed_noise(ip.seed ? ip.seed : time(NULL));
+
+    if (ip.checkpoint_on_signal) {
+        signal(SIGTERM, request_stop);
+        signal(SIGUSR1, request_stop);
+    }
+
+    // omp_threads = 0 leaves the thread count to OMP_NUM_THREADS
+    int nthreads = 1;
+#ifdef _OPENMP
+    if (ip.omp_threads > 0) omp_set_num_threads(ip.omp_threads);
+    nthreads = omp_get_max_threads();
+    FFTW(plan_with_nthreads)(nthreads);
+#endif
+
+    ptrdiff_t local_n0, local_n1;
+    ptrdiff_t local_0_start, local_1_start;
     ptrdiff_t N0 = (ptrdiff_t) ip.Nx;
     ptrdiff_t N1 = (ptrdiff_t) ip.Ny;
 
-    ptrdiff_t alloc_local = fftw_mpi_local_size_2d(N0, N1/2+1, MPI_COMM_WORLD, &local_n0, &local_0_start);
+    // the transposed sizes cover both layouts, so they are used for allocation in either mode
+    ptrdiff_t alloc_local = FFTW(mpi_local_size_2d_transposed)(N0, N1/2+1, MPI_COMM_WORLD, 
+                                                              &local_n0, &local_0_start, &local_n1, &local_1_start);
 
-    double * ux;        // in-plane displacement in the x-direction     ux[ndx]
-    double * uy;        // in-plane displacement in the y-direction     uy[ndx]
-    double * phi;       // material composition                         phi[ndx]
+    // the batched transforms need room for several interleaved fields
+    const ptrdiff_t n[2] = {N0, N1/2+1};
+    const ptrdiff_t block = FFTW_MPI_DEFAULT_BLOCK;
+    ptrdiff_t alloc_local2 = FFTW(mpi_local_size_many_transposed)(2, n, 2, block, block, MPI_COMM_WORLD, 
+                                                                 &local_n0, &local_0_start, &local_n1, &local_1_start);
+    ptrdiff_t alloc_local3 = FFTW(mpi_local_size_many_transposed)(2, n, 3, block, block, MPI_COMM_WORLD, 
+                                                                 &local_n0, &local_0_start, &local_n1, &local_1_start);
+
+    // number of local k-space points, the k-space kernels are pointwise and only need this count
+    ptrdiff_t local_nk = ip.fftw_transposed ? local_n1*N0 : local_n0*(N1/2+1);
+
+    real * ux;          // in-plane displacement in the x-direction     ux[ndx]
+    real * uy;          // in-plane displacement in the y-direction     uy[ndx]
+    real * phi;         // material composition                         phi[ndx]
     double * lsf;       // level set function - used for initialization lsf[ndx]
-    double ** eta;      // orientation order parmater                   eta[p][ndx]
-    double ** eta_old;  // previous step order parmater                 eta[p][ndx]
-    double ** eta_new;  // next step order parmater                     eta[p][ndx]
-
-    double **** lam;    // stiffness tensor         lam[i][j][k][l]
-    double *** G;       // greens functions         G[i][j][ndx]
-    double ** kxy;      // fourier k-vectors        kxy[i][ndx] 
-    double **** epsT;   // transformation strains   epsT[M][p][i][j]
-    double **** eps0;   // transformation strains   eps0[p][i][j][ndx]
-    double **** sig0;   // transformation stress    sig0[p][i][j][ndx]
-    double *** sigeps;  // sig0*eps0                sigeps[p][q][ndx]
-    double ** epsbar;   // homogeneous strain       epsbar[i][j]
-    double *** eps;     // heterogeneous strain     eps[p][i][j][ndx]
-    double *** s0n2;    // sig0*eta                 s0n2[p][i+j][ndx]
-    double ** chem;     // chemical potential       chem[p][ndx]
-    double * w;         // out-of-plane bending     w[ndx]
-    double ** dw;       // first derivatives        dw[i][ndx]
-    double ** ddw;      // second derivatives       dw[i+j][ndx]
-    double * dFdw;      // delta F / delta w        dFdw[ndx]                    
-    double * w_old;
-    double * w_new;
-    fftw_complex *** ks0n2; // fourier transform of s0n2, ks0n2[p][j+k][ndx]
+    real * s0n2;        // sum_p sig0*eta^2         s0n2[3*ndx + i+j]
+    real * w;           // out-of-plane bending     w[ndx]
+    real * dFdw;        // delta F / delta w        dFdw[ndx]                    
+    real * w_old;
+    FFTW(complex) * ks0n2;   // fourier transform of s0n2, ks0n2[3*ndx + j+k]
+
+    // the tensor fields are contiguous aligned blocks (field.h), indexed like the arrays above
+    TensorField<real, 2> eta;       // orientation order parmater   eta[p][ndx]
+    TensorField<real, 2> eta_old;   // previous step order parmater eta[p][ndx]
+    TensorField<real, 2> lap;       // laplacian of eta             lap[p][ndx]
+
+    TensorField<real, 4> lam;       // stiffness tensor         lam[i][j][k][l]
+    TensorField<real, 3> G;         // greens functions         G[i][j][ndx]
+    TensorField<real, 2> kxy;       // fourier k-vectors        kxy[i][ndx] 
+    TensorField<real, 2> kop;       // k-space operators        kop[op][ndx]
+    TensorField<real, 2> epsP;      // strain operator, stress  epsP[n][ndx]
+    TensorField<real, 3> epsQ;      // strain operator, bending epsQ[e][j][ndx]
+    TensorField<real, 4> epsT;      // transformation strains   epsT[M][p][i][j]
+    TensorField<real, 4> eps0;      // transformation strains   eps0[p][i][j][ndx]
+    TensorField<real, 4> sig0;      // transformation stress    sig0[p][i][j][ndx]
+    TensorField<real, 3> sigeps;    // sig0*eps0                sigeps[p][q][ndx]
+    TensorField<real, 2> epsbar;    // homogeneous strain       epsbar[i][j]
+    TensorField<real, 3> eps;       // heterogeneous strain     eps[p][i][j][ndx]
+    TensorField<real, 2> dw;        // first derivatives        dw[i][ndx]
+    TensorField<real, 2> ddw;       // second derivatives       dw[i+j][ndx]
 
     // allocate all of the memory needed for the simulation
 
-    lam     = (double ****) kd_alloc2(sizeof(double), 4, 2, 2, 2, 2);
-    G       = (double ***)  kd_alloc2(sizeof(double), 3, 2, 2, alloc_local);
-    kxy     = (double **)   kd_alloc2(sizeof(double), 2, 2, alloc_local);
-    epsT    = (double ****) kd_alloc2(sizeof(double), 4, 2, 3, 2, 2);
-    eps0    = (double ****) kd_alloc2(sizeof(double), 4, 3, 2, 2, 2*alloc_local);
-    sig0    = (double ****) kd_alloc2(sizeof(double), 4, 3, 2, 2, 2*alloc_local);
-    sigeps  = (double ***)  kd_alloc2(sizeof(double), 3, 3, 3, 2*alloc_local);
-    epsbar  = (double **)   kd_alloc2(sizeof(double), 2, 2, 2);
-    eps     = (double ***)  kd_alloc2(sizeof(double), 3, 2, 2, 2*alloc_local);
-    s0n2    = (double ***)  kd_alloc2(sizeof(double), 3, 3, 3, 2*alloc_local);
-    ks0n2   = (fftw_complex ***) kd_alloc2(sizeof(fftw_complex), 3, 3, 3, alloc_local);
-
-    w       = fftw_alloc_real(2*alloc_local);
-    w_old   = fftw_alloc_real(2*alloc_local);
-    w_new   = fftw_alloc_real(2*alloc_local);
-    dFdw    = fftw_alloc_real(2*alloc_local);
-    dw      = (double **) kd_alloc2(sizeof(double), 2, 2, 2*alloc_local);
-    ddw     = (double **) kd_alloc2(sizeof(double), 2, 3, 2*alloc_local);
-
-    chem = new double * [3];
-    chem[0] = fftw_alloc_real(2*alloc_local);
-    chem[1] = fftw_alloc_real(2*alloc_local);
-    chem[2] = fftw_alloc_real(2*alloc_local);
-
-    eta = new double * [3];
-    eta[0] = fftw_alloc_real(2*alloc_local);
-    eta[1] = fftw_alloc_real(2*alloc_local);
-    eta[2] = fftw_alloc_real(2*alloc_local);
-
-    eta_old = new double * [3];
-    eta_old[0] = fftw_alloc_real(2*alloc_local);
-    eta_old[1] = fftw_alloc_real(2*alloc_local);
-    eta_old[2] = fftw_alloc_real(2*alloc_local);
-
-    eta_new = new double * [3];
-    eta_new[0] = fftw_alloc_real(2*alloc_local);
-    eta_new[1] = fftw_alloc_real(2*alloc_local);
-    eta_new[2] = fftw_alloc_real(2*alloc_local);
-
-    double ** lap = new double * [3];
-    lap[0] = fftw_alloc_real(2*alloc_local);
-    lap[1] = fftw_alloc_real(2*alloc_local);
-    lap[2] = fftw_alloc_real(2*alloc_local);
-
-    fftw_complex ** ketapsq = new fftw_complex * [3];
-    ketapsq[0] = fftw_alloc_complex(alloc_local);
-    ketapsq[1] = fftw_alloc_complex(alloc_local);
-    ketapsq[2] = fftw_alloc_complex(alloc_local);
-
-    fftw_complex ** keta = new fftw_complex * [3];
-    keta[0] = fftw_alloc_complex(alloc_local);
-    keta[1] = fftw_alloc_complex(alloc_local);
-    keta[2] = fftw_alloc_complex(alloc_local);
-
-    fftw_complex ** klap = new fftw_complex * [3];
-    klap[0] = fftw_alloc_complex(alloc_local);
-    klap[1] = fftw_alloc_complex(alloc_local);
-    klap[2] = fftw_alloc_complex(alloc_local);
-
-    fftw_complex ** keps = new fftw_complex * [3];
-    keps[0] = fftw_alloc_complex(alloc_local);
-    keps[1] = fftw_alloc_complex(alloc_local);
-    keps[2] = fftw_alloc_complex(alloc_local);
-
-    ux = fftw_alloc_real(2*alloc_local);
-    uy = fftw_alloc_real(2*alloc_local);
-    phi = fftw_alloc_real(2*alloc_local);
-    lsf = fftw_alloc_real(local_n0*N1);
-
-    fftw_complex ** ku = new fftw_complex * [2];
-    ku[0] = fftw_alloc_complex(alloc_local);
-    ku[1] = fftw_alloc_complex(alloc_local);
+    lam.allocate(2, 2, 2, 2);
+    G.allocate(2, 2, alloc_local);
+    kxy.allocate(2, alloc_local);
+    kop.allocate(NKOP, alloc_local);
+    epsP.allocate(6, alloc_local);
+    epsQ.allocate(3, 2, alloc_local);
+    epsT.allocate(2, 3, 2, 2);
+
+    // elastic_tensors = inline keeps only the per-material constants, see elastic.h
+    ElasticTensors el;
+    el.stored = ip.elastic_tensors == "stored";
+    if (el.stored) {
+        eps0.allocate(3, 2, 2, 2*alloc_local);
+        sig0.allocate(3, 2, 2, 2*alloc_local);
+        sigeps.allocate(3, 3, 2*alloc_local);
+        el.sig0 = sig0;
+        el.sigeps = sigeps;
+    }
+
+    epsbar.allocate(2, 2);
+    eps.allocate(2, 2, 2*alloc_local);
+
+    w       = FFTW(alloc_real)(2*alloc_local);
+    w_old   = FFTW(alloc_real)(2*alloc_local);
+
+    // w is read in k-space by calc_dw and calc_dFdw (or step_w_etd), the transform is shared
+    // through the cache and retaken only after w has been written (spectral.h)
+    SpectralField w_spec;
+    w_spec.r = w;
+    w_spec.k = FFTW(alloc_complex)(alloc_local);
+    dw.allocate(2, 2*alloc_local);
+    ddw.allocate(3, 2*alloc_local);
+
+    eta.allocate(3, 2*alloc_local);
+    eta_old.allocate(3, 2*alloc_local);
+    lap.allocate(3, 2*alloc_local);
+
+    phi = FFTW(alloc_real)(2*alloc_local);
+    el.phi = phi;
+    lsf = new double [local_n0*N1];
+
+    // the relaxation engines and the semi-implicit step take the chemical potential as a separate field
+    RelaxationEngine * engine = create_relaxation_engine(ip.relaxation, local_n0, N1, ip);
+    bool semi_implicit = ip.relaxation == "semi_implicit";
+    TensorField<real, 2> chem;
+    if (engine || semi_implicit) chem.allocate(3, 2*alloc_local);
+
+    // the transform buffers only hold intermediate results of one stage of an iteration or pass
+    // them to a later stage, buffers that are never live at the same stage share memory (scratch.h)
+    // the stages of an iteration in order, noise is added to eta_batch in the LAP stage
+    // the displacement (UXY) is only formed on output frames with out_displacement
+    enum { KS0N2, UXY, EPS, LAP, ETA, DW, DFDW };
+
+    // the semi-implicit step transforms eta once more through the calc_lap buffers
+    int lap_last = semi_implicit ? ETA : LAP;
+
+    real * eta_batch, * lap_batch, * eps_batch, * N_lam, * temp[2];
+    FFTW(complex) * keta, * klap, * keps, * kN_lam, * kdFdw;
+    FFTW(complex) * ku[2], * kdw[2], * kddw[3], * ktemp[2];
+
+    ScratchPlanner scratch;
+    scratch.add("s0n2",      &s0n2,      2*alloc_local3, KS0N2, DFDW);
+    scratch.add("ks0n2",     &ks0n2,     alloc_local3,   KS0N2, EPS);
+    scratch.add("N_lam",     &N_lam,     2*alloc_local2, UXY,   UXY);
+    scratch.add("kN_lam",    &kN_lam,    alloc_local2,   UXY,   EPS);
+    ux = NULL;
+    uy = NULL;
+    if (ip.out_displacement) {
+        scratch.add("ku[0]", &ku[0],     alloc_local,    UXY,   UXY);
+        scratch.add("ku[1]", &ku[1],     alloc_local,    UXY,   UXY);
+        scratch.add("ux",    &ux,        2*alloc_local,  UXY,   UXY);
+        scratch.add("uy",    &uy,        2*alloc_local,  UXY,   UXY);
+    }
+    scratch.add("keps",      &keps,      alloc_local3,   EPS,   EPS);
+    scratch.add("eps_batch", &eps_batch, 2*alloc_local3, EPS,   EPS);
+    scratch.add("eta_batch", &eta_batch, 2*alloc_local3, LAP,   lap_last);
+    scratch.add("keta",      &keta,      alloc_local3,   LAP,   lap_last);
+    scratch.add("klap",      &klap,      alloc_local3,   LAP,   lap_last);
+    scratch.add("lap_batch", &lap_batch, 2*alloc_local3, LAP,   lap_last);
+    scratch.add("kdw[0]",    &kdw[0],    alloc_local,    DW,    DW);
+    scratch.add("kdw[1]",    &kdw[1],    alloc_local,    DW,    DW);
+    scratch.add("kddw[0]",   &kddw[0],   alloc_local,    DW,    DW);
+    scratch.add("kddw[1]",   &kddw[1],   alloc_local,    DW,    DW);
+    scratch.add("kddw[2]",   &kddw[2],   alloc_local,    DW,    DW);
+    scratch.add("temp[0]",   &temp[0],   2*alloc_local,  DFDW,  DFDW);
+    scratch.add("temp[1]",   &temp[1],   2*alloc_local,  DFDW,  DFDW);
+    scratch.add("ktemp[0]",  &ktemp[0],  alloc_local,    DFDW,  DFDW);
+    scratch.add("ktemp[1]",  &ktemp[1],  alloc_local,    DFDW,  DFDW);
+    scratch.add("kdFdw",     &kdFdw,     alloc_local,    DFDW,  DFDW);
+    scratch.add("dFdw",      &dFdw,      2*alloc_local,  DFDW,  DFDW);
+    scratch.allocate();
+
+    // the fields that persist through the run
+    size_t field_bytes = eta.bytes() + eta_old.bytes() + lap.bytes() + chem.bytes() 
+                       + G.bytes() + kxy.bytes() + kop.bytes() + epsP.bytes() + epsQ.bytes()
+                       + eps0.bytes() + sig0.bytes() + sigeps.bytes() + eps.bytes() + dw.bytes() + ddw.bytes()
+                       + 3*2*alloc_local*sizeof(real) + alloc_local*sizeof(FFTW(complex)) + local_n0*N1*sizeof(double)
+                       + (ip.w_integrator == "etd" ? 2*alloc_local*sizeof(real) : 0);
 
 
     // initialize the necessary fourier transforms
+    // previously gathered wisdom for this grid, rank and thread count and planner is reused when available
 
-    planF_eta[0] = fftw_mpi_plan_dft_r2c_2d(N0, N1, eta[0], keta[0], MPI_COMM_WORLD, FFTW_MEASURE);
-    planF_eta[1] = fftw_mpi_plan_dft_r2c_2d(N0, N1, eta[1], keta[1], MPI_COMM_WORLD, FFTW_MEASURE);
-    planF_eta[2] = fftw_mpi_plan_dft_r2c_2d(N0, N1, eta[2], keta[2], MPI_COMM_WORLD, FFTW_MEASURE);
+    int np, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    planB_lap[0] = fftw_mpi_plan_dft_c2r_2d(N0, N1, klap[0], lap[0], MPI_COMM_WORLD, FFTW_MEASURE);
-    planB_lap[1] = fftw_mpi_plan_dft_c2r_2d(N0, N1, klap[1], lap[1], MPI_COMM_WORLD, FFTW_MEASURE);
-    planB_lap[2] = fftw_mpi_plan_dft_c2r_2d(N0, N1, klap[2], lap[2], MPI_COMM_WORLD, FFTW_MEASURE);
+    unsigned fftw_flags = planner_flags(ip.fftw_planner);
 
-    for (int p=0; p<3; p++)
-    for (int i=0; i<3; i++)
-        planF_s0n2[p][i] = fftw_mpi_plan_dft_r2c_2d(N0, N1, s0n2[p][i], ks0n2[p][i], MPI_COMM_WORLD, FFTW_MEASURE);
+    // in transposed mode k-space data stays in the transposed layout, saving a global transpose per transform
+    unsigned flagsF = fftw_flags | (ip.fftw_transposed ? FFTW_MPI_TRANSPOSED_OUT : 0);
+    unsigned flagsB = fftw_flags | (ip.fftw_transposed ? FFTW_MPI_TRANSPOSED_IN : 0);
+    std::string wisdom_file = wisdom_filename(ip.fftw_wisdom_dir, ip.Nx, ip.Ny, np, nthreads, ip.fftw_planner);
+    double plan_time = MPI_Wtime();
 
-    planB_ux = fftw_mpi_plan_dft_c2r_2d(N0, N1, ku[0], ux, MPI_COMM_WORLD, FFTW_MEASURE);
-    planB_uy = fftw_mpi_plan_dft_c2r_2d(N0, N1, ku[1], uy, MPI_COMM_WORLD, FFTW_MEASURE);
+    if (ip.fftw_wisdom) {
+        bool found = import_wisdom(wisdom_file);
+        if (rank == 0) printf("fftw wisdom %s: %s\n", found ? "imported" : "not found", wisdom_file.c_str());
+    }
+
+    const ptrdiff_t nr[2] = {N0, N1};
+
+    planF_eta = FFTW(mpi_plan_many_dft_r2c)(2, nr, 3, block, block, eta_batch, keta, MPI_COMM_WORLD, flagsF);
+    planB_lap = FFTW(mpi_plan_many_dft_c2r)(2, nr, 3, block, block, klap, lap_batch, MPI_COMM_WORLD, flagsB);
+    planF_s0n2 = FFTW(mpi_plan_many_dft_r2c)(2, nr, 3, block, block, s0n2, ks0n2, MPI_COMM_WORLD, flagsF);
+
+    if (ip.out_displacement) {
+        planB_ux = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, ku[0], ux, MPI_COMM_WORLD, flagsB);
+        planB_uy = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, ku[1], uy, MPI_COMM_WORLD, flagsB);
+    }
+
+    plan_strain = FFTW(mpi_plan_many_dft_c2r)(2, nr, 3, block, block, keps, eps_batch, MPI_COMM_WORLD, flagsB);
+
+    w_spec.plan = FFTW(mpi_plan_dft_r2c_2d)(N0, N1, w, w_spec.k, MPI_COMM_WORLD, flagsF);
+
+    planB_dw[0] = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, kdw[0], dw[0], MPI_COMM_WORLD, flagsB);
+    planB_dw[1] = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, kdw[1], dw[1], MPI_COMM_WORLD, flagsB);
+
+    planB_ddw[0] = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, kddw[0], ddw[0], MPI_COMM_WORLD, flagsB);
+    planB_ddw[1] = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, kddw[1], ddw[1], MPI_COMM_WORLD, flagsB);
+    planB_ddw[2] = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, kddw[2], ddw[2], MPI_COMM_WORLD, flagsB);
+
+    planF_temp[0] = FFTW(mpi_plan_dft_r2c_2d)(N0, N1, temp[0], ktemp[0], MPI_COMM_WORLD, flagsF);
+    planF_temp[1] = FFTW(mpi_plan_dft_r2c_2d)(N0, N1, temp[1], ktemp[1], MPI_COMM_WORLD, flagsF);
+
+    planB_dFdw = FFTW(mpi_plan_dft_c2r_2d)(N0, N1, kdFdw, dFdw, MPI_COMM_WORLD, flagsB);
+
+    planF_N = FFTW(mpi_plan_many_dft_r2c)(2, nr, 2, block, block, N_lam, kN_lam, MPI_COMM_WORLD, flagsF);
+
+    if (ip.fftw_wisdom) export_wisdom(wisdom_file);
 
-    plan_strain_xx = fftw_mpi_plan_dft_c2r_2d(N0, N1, keps[0], eps[0][0], MPI_COMM_WORLD, FFTW_MEASURE);
-    plan_strain_yy = fftw_mpi_plan_dft_c2r_2d(N0, N1, keps[1], eps[1][1], MPI_COMM_WORLD, FFTW_MEASURE);
-    plan_strain_xy = fftw_mpi_plan_dft_c2r_2d(N0, N1, keps[2], eps[0][1], MPI_COMM_WORLD, FFTW_MEASURE);
+    plan_time = MPI_Wtime() - plan_time;
+    if (rank == 0) printf("fftw planning (%s): %.2f s\n", ip.fftw_planner.c_str(), plan_time);
+    if (rank == 0) printf("precision: %s\n", PRECISION_NAME);
+    if (rank == 0) printf("real-space kernels: %s\n", ip.simd_kernels ? simd_isa() : "scalar");
+    if (rank == 0) printf("relaxation: %s\n", ip.relaxation.c_str());
+    if (rank == 0) printf("elastic tensors: %s (%.1f MB per rank)\n", ip.elastic_tensors.c_str(), 
+                          (eps0.bytes() + sig0.bytes() + sigeps.bytes())/1048576.0);
+    if (rank == 0) printf("w integrator: %s, %d step(s) per iteration\n", ip.w_integrator.c_str(), ip.w_subcycles);
+    if (rank == 0) printf("memory per rank: %.1f MB fields + %.1f MB scratch (%.1f MB without aliasing)\n", 
+                          field_bytes/1048576.0, scratch.bytes()/1048576.0, scratch.unaliased_bytes()/1048576.0);
+    if (rank == 0) scratch.print_layout(stdout);
+    if (rank == 0) printf("%d ranks x %d threads\n", np, nthreads);
+
+    // without a parallel hdf5 build the output is always gathered on rank 0
+    if (!parallel_output_available()) ip.parallel_io = 0;
+
+    // the output thread needs full MPI thread support, otherwise the frames are written synchronously
+    if (thread_support < MPI_THREAD_MULTIPLE) ip.async_output = 0;
+
+    if (rank == 0) printf("output: %s%s\n", ip.parallel_io ? "parallel hdf5 (MPI-IO)" : "gathered on rank 0",
+                                             ip.async_output ? ", asynchronous" : "");
 
 
     // calculate the elastic parameters
 
-    calc_greens_function(G, kxy, local_n0, local_0_start, N1, ip);
+    calc_greens_function(G, kxy, local_n0, local_0_start, local_n1, local_1_start, N1, ip);
+    // the k-space operators carry the normalization of the inverse transforms
+    const double norm = 1.0/((double) N0*N1);
+    calc_spectral_operators(kop, kxy, local_nk, norm, ip);
+    calc_strain_operators(epsP, epsQ, G, kxy, local_nk, norm);
+
+    // the exponential integrator for w only needs its coefficients once
+    bool w_etd = ip.w_integrator == "etd";
+    real * etd_c1 = NULL;
+    real * etd_b = NULL;
+    double etd_c2 = 0;
+    if (w_etd) {
+        etd_c1 = FFTW(alloc_real)(alloc_local);
+        etd_b = FFTW(alloc_real)(alloc_local);
+        etd_c2 = init_w_etd(etd_c1, etd_b, kxy, local_nk, norm, ip);
+    }
     calc_transformation_strains(epsT, ip);
 
     // initialize the system with in-plane heterogeneity
@@ -1142,36 +1719,89 @@ int main(int argc, char ** argv)
     diffuse_lsf(lsf, local_n0, N1);
     copy_lsf(lsf, phi, local_n0, N1);
 
-    for (int p=0; p<3; p++)
-    for (int i=0; i<2; i++)
-    for (int j=0; j<2; j++)
-        interpolate(eps0[p][i][j], epsT[0][p][i][j], epsT[1][p][i][j], phi, local_n0, N1);
+    calc_stiffness_tensor(lam, ip.mu_el, ip.nu_el);
+
+    if (el.stored) {
+        for (int p=0; p<3; p++)
+        for (int i=0; i<2; i++)
+        for (int j=0; j<2; j++)
+            interpolate(eps0[p][i][j], epsT[0][p][i][j], epsT[1][p][i][j], phi, local_n0, N1);
 
-    calc_elastic_tensors(lam, eps0, sig0, sigeps, ip.mu_el, ip.nu_el, local_n0, N1);
+        calc_elastic_tensors(lam, eps0, sig0, sigeps, local_n0, N1, ip.simd_kernels);
+    }
+    else calc_elastic_constants(el, lam, epsT);
 
-    log_greens_function(G, kxy, local_n0, N1);
+    log_greens_function(G, kxy, local_nk);
     log_elastic_tensors(lam, epsT);
 
     // initialize eta parameters to zero
     initialize(eta, eta_old, local_n0, N1);
 
     // initialize displacements to zero
-    for (int i=0; i<2*alloc_local; i++) { ux[i]=0; uy[i]=0; w_old[i]=0; w[i]=0; }
+    // (the derivatives too, since planning may overwrite them)
+    for (int i=0; i<2*alloc_local; i++) { w_old[i]=0; w[i]=0; }
+    w_spec.touch();
+    for (int i=0; i<2*alloc_local; i++) { dw[0][i]=0; dw[1][i]=0; ddw[0][i]=0; ddw[1][i]=0; ddw[2][i]=0; }
+
+    // the solver state that is carried from one iteration to the next, everything else is 
+    // recomputed from it (dw and ddw are used before they are updated in an iteration)
+    const int nstate = 13;
+    std::string state_names[nstate] = {"eta0", "eta1", "eta2", "eta_old0", "eta_old1", "eta_old2", 
+                                       "w", "w_old", "dw0", "dw1", "ddw0", "ddw1", "ddw2"};
+    real * state[nstate] = {eta[0], eta[1], eta[2], eta_old[0], eta_old[1], eta_old[2], 
+                              w, w_old, dw[0], dw[1], ddw[0], ddw[1], ddw[2]};
+
+    int start_step = 0;
+    int frame = 0;
+    FILE * fp;
 
-    // begin writing the output file
-    H5File h5;
-    h5.open("out.h5", "w");
-    output("phi", phi, N0, N1, local_n0);
-    h5.close();
+    if (ip.restart) {
+        unsigned int saved_rng[rng_size];
+        read_checkpoint(ip.checkpoint_file, nstate, state_names, state, start_step, frame, saved_rng, rng_size, 
+                        N0, N1, local_n0, local_0_start);
+        restore_noise_state(saved_rng);
+        w_spec.touch();
 
-    FILE * fp = fopen("area_fraction.dat", "w");
-    fclose(fp);
+        // drop the frames and area fractions written after the checkpoint
+        trim_output("out.h5", frame, ip.parallel_io, MPI_COMM_WORLD);
+        if (rank == 0) trim_area_fraction(start_step);
+
+        if (rank == 0) printf("restart from %s at step %d, frame %d\n", ip.checkpoint_file.c_str(), start_step, frame);
+    } else {
+        create_output("out.h5", ip.parallel_io, MPI_COMM_WORLD);
+
+        fp = fopen("area_fraction.dat", "w");
+        fclose(fp);
+    }
+
+    // begin writing the output file
+    OutputWriter writer(N0, N1, local_n0, local_0_start, ip.parallel_io, ip.async_output, 
+                        ip.out_chunk_x, ip.out_chunk_y);
+    OutputFormat eta_format = output_format(ip.out_format_eta, ip.out_deflate);
+    OutputFormat w_format = output_format(ip.out_format_w, ip.out_deflate);
+    OutputFormat phi_format = output_format(ip.out_format_phi, ip.out_deflate);
+    OutputFormat u_format = output_format(ip.out_format_u, ip.out_deflate);
+
+    // hdf5 does not filter MPI-IO writes, compressed or quantized fields are gathered on rank 0 instead
+    bool filtered = output_filtered(eta_format) || output_filtered(w_format) || output_filtered(phi_format) || 
+                    (ip.out_displacement && output_filtered(u_format));
+    if (rank == 0 && ip.parallel_io && filtered) 
+        printf("output: compressed fields (out_deflate > 0 or scale:D) are gathered on rank 0\n");
+
+    if (!ip.restart) {
+        std::string phi_path = "phi";
+        writer.submit(1, &phi_path, &phi, &phi_format);
+    }
 
     
     // begin the simulation loop
-    int frame = 0;
-    for (int step=1; step<=ip.nsteps; step++)
+    double max_step_time = 0;
+    long inner_iterations = 0;
+    int load_steps = 0;
+    for (int step=start_step+1; step<=ip.nsteps; step++)
     {
+        double step_start = MPI_Wtime();
+
         // increase load on system
         epsbar[0][0] = ip.epsx * (step/(double)ip.nsteps);
         epsbar[1][1] = ip.epsy * (step/(double)ip.nsteps);
@@ -1179,57 +1809,98 @@ int main(int argc, char ** argv)
         epsbar[1][0] = 0;
 
         // iterative relaxation loop for eta_p parameters
+        if (engine) engine->reset();
         double change_etap_max = 1;
-        double area_fraction;
+        double area_fraction = 0, area_prev = -1;
         while (change_etap_max > ip.change_etap_thresh)
         {
             change_etap_max = 0;
+            inner_iterations++;
 
             // fourier transform the nonlinear term in displacement equation sig0_{jk}*eta_p^2
-            calc_ks0n2(s0n2, sig0, eta, local_n0, N1);
+            calc_ks0n2(s0n2, el, eta, local_n0, N1);
 
-            // calculate the displacement in k-space using greens function
-            //calc_uxy(ux, uy, ku, G, kxy, ks0n2, N0, N1, local_n0);
-            calc_uxy_bending(ux, uy, ku, dw, ddw, lam, G, kxy, ks0n2, N0, N1, local_n0);
+            // fourier transform the bending term lam_{jklm}*dw_k*ddw_lm
+            calc_kN_lam(N_lam, lam, dw, ddw, local_n0, N1);
 
-            // calculate the heterogeneous strain (delta-epsilon) in k-space
-            calc_eps(eps, keps, kxy, ku, N0, N1, local_n0);
+            // calculate the heterogeneous strain (delta-epsilon) in k-space straight from the sources
+            calc_eps(eps, keps, eps_batch, epsP, epsQ, ks0n2, kN_lam, N1, local_n0, local_nk);
 
             // introduce random noise into the eta parameters
-            introduce_noise(eta, local_n0, N1);
+            introduce_noise(eta, eta_batch, local_n0, N1);
 
             // calculate the laplacian of the eta parameters (for the gradient squared energy term)
-            calc_lap(lap, klap, keta, kxy, N0, N1, local_n0);
-
-            // calculate the chemical potential for the eta parameters 
-            calc_chemical_potential(chem, eta, sigeps, epsbar, sig0, eps, lap, phi, dw, local_n0, N1, ip);
-
-            // step the eta parameters in time using the evolution wave equation
-            change_etap_max = update_eta(eta, eta_old, eta_new, chem, local_n0, N1, ip);
+            calc_lap(lap, lap_batch, klap, keta, kop[KOP_LAP], N1, local_n0, local_nk);
+
+            // calculate the chemical potential and step the eta parameters in time using the evolution wave equation
+            // or one of the accelerated relaxation engines
+            // the engine takes over from the wave equation once some of the area has transformed in this load step 
+            // and the transformed area has stopped changing, the inertia of the wave steps moves the interfaces (relax.h)
+            bool engine_step = engine && area_fraction > 0 && area_fraction == area_prev;
+            double area_count;
+            if (engine_step || semi_implicit) {
+                if (ip.simd_kernels)
+                    calc_chemical_potential_simd(chem, eta, el, epsbar, eps, lap, phi, dw, local_n0, N1, ip);
+                else
+                    calc_chemical_potential(chem, eta, el, epsbar, eps, lap, phi, dw, local_n0, N1, ip);
+
+                if (engine_step)
+                    change_etap_max = engine->update(eta, eta_old, chem, &area_count);
+                else
+                    change_etap_max = update_eta_semi_implicit(eta, eta_old, chem, lap, eta_batch, lap_batch, keta, klap, 
+                                                               kop[KOP_SEMI], &area_count, N0, N1, local_n0, local_nk, ip);
+            }
+            else if (ip.simd_kernels)
+                change_etap_max = update_eta_simd(eta, eta_old, el, epsbar, eps, lap, phi, dw, &area_count, local_n0, N1, ip);
+            else
+                change_etap_max = update_eta(eta, eta_old, el, epsbar, eps, lap, phi, dw, &area_count, local_n0, N1, ip);
 
             // share convergence info with all processes for parallel computation
             MPI_Allreduce(MPI_IN_PLACE, &change_etap_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+            MPI_Allreduce(MPI_IN_PLACE, &area_count, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            area_prev = area_fraction;
+            area_fraction = area_count/(N0*N1);
 
-            // the rest for out-of-plane displacements - in progress
+            // every rank sees the same reduced change, so all of them stop here
+            if (!std::isfinite(change_etap_max))
+                throw std::runtime_error("eta diverged at step " + std::to_string(step) + 
+                                         ", reduce the time step (or raise semi_implicit_stab)");
 
-            // calculate first derivatives of the out-of-plane displacement
-            calc_dw(w, dw, ddw, kxy, N0, N1, local_n0);
-
-            // calculate the chemical potential of out-of-plane displacement
-            calc_dFdw(dFdw, w, dw, lam, eps, epsbar, s0n2, kxy, local_n0, N0, N1, ip.kappa);
+            // the rest for out-of-plane displacements - in progress
 
-            // step w in time using evolution wave equation
-            update_w(w, w_old, w_new, dFdw, local_n0, N1, ip);
+            // w takes w_subcycles steps per eta iteration
+            for (int sub=0; sub<ip.w_subcycles; sub++)
+            {
+                // calculate first derivatives of the out-of-plane displacement
+                calc_dw(dw, ddw, w_spec, kdw, kddw, kxy, N0, N1, local_n0, local_nk);
+
+                if (w_etd) {
+                    // step w with the bending term integrated exactly
+                    step_w_etd(w_spec, w_old, dFdw, dw, temp, ktemp, kdFdw, etd_c1, etd_b, etd_c2, 
+                               lam, eps, epsbar, s0n2, kxy, local_n0, local_nk, N0, N1, ip);
+                } else {
+                    // calculate the chemical potential of out-of-plane displacement
+                    calc_dFdw(dFdw, dw, temp, ktemp, kdFdw, w_spec, lam, eps, epsbar, s0n2, kxy, kop[KOP_BEND], local_n0, local_nk, N0, N1, ip.simd_kernels);
+
+                    // step w in time using evolution wave equation
+                    update_w(w, w_old, dFdw, local_n0, N1, ip);
+                }
+
+                // every write to w invalidates its transform
+                w_spec.touch();
+            }
+            // one kick per inner iteration, so w depends on the number of iterations the relaxation takes
             add_w_noise(w, local_n0, N1);
+            w_spec.touch();
 
             std::cout << "w = " << max(w, local_n0, N1) << std::endl;
 
-            // calculate and output area - will change in future versions
-            area_fraction = calc_area(eta, local_n0, N0, N1, ip.M1_norm);
+            // output area - will change in future versions
             printf("%8d cepmax=%12.10f, Af=%12.10f\n",step,change_etap_max,area_fraction);
         }
 
         // eta_p parameters have reached a thermodynamic and mechanical equilibrium
+        load_steps++;
 
         fp = fopen("area_fraction.dat", "a");
         fprintf(fp, "%10d %12.10f\n", step, area_fraction);
@@ -1238,14 +1909,56 @@ int main(int argc, char ** argv)
         // output eta_p data
         if (step % ip.out_freq == 0) {
             frame++;
-            output("eta0/"+zeroFill(frame), eta[0], N0, N1, local_n0);
-            output("eta1/"+zeroFill(frame), eta[1], N0, N1, local_n0);
-            output("eta2/"+zeroFill(frame), eta[2], N0, N1, local_n0);
-            output("w/"+zeroFill(frame), w, N0, N1, local_n0);
+
+            // the solver only needs the strain, the displacement is formed here from the sources 
+            // of the converged state (the transform buffers of the last iteration have been reused)
+            if (ip.out_displacement) {
+                calc_ks0n2(s0n2, el, eta, local_n0, N1);
+                calc_kN_lam(N_lam, lam, dw, ddw, local_n0, N1);
+                calc_uxy_bending(ku, kN_lam, G, kxy, ks0n2, N0, N1, local_nk);
+            }
+
+            std::string paths[6] = {"eta0/"+zeroFill(frame), "eta1/"+zeroFill(frame), 
+                                    "eta2/"+zeroFill(frame), "w/"+zeroFill(frame),
+                                    "ux/"+zeroFill(frame), "uy/"+zeroFill(frame)};
+            real * fields[6] = {eta[0], eta[1], eta[2], w, ux, uy};
+            OutputFormat formats[6] = {eta_format, eta_format, eta_format, w_format, u_format, u_format};
+            writer.submit(ip.out_displacement ? 6 : 4, paths, fields, formats);
+        }
+
+        // checkpoint periodically, and stop with a checkpoint when the scheduler sends SIGTERM/SIGUSR1
+        // or when the next step might not finish within the wall clock limit
+        max_step_time = std::max(max_step_time, MPI_Wtime() - step_start);
+
+        int stop = stop_requested;
+        if (ip.walltime > 0 && MPI_Wtime() - start_time + max_step_time > ip.walltime) stop = 1;
+        MPI_Allreduce(MPI_IN_PLACE, &stop, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+        if (stop || (ip.checkpoint_freq > 0 && step % ip.checkpoint_freq == 0)) {
+            // hdf5 is not thread safe, the output thread must be idle
+            writer.flush();
+            save_noise_state();
+            write_checkpoint(ip.checkpoint_file, nstate, state_names, state, step, frame, rng_state, rng_size,
+                             N0, N1, local_n0, local_0_start, ip.parallel_io);
+            if (rank == 0) printf("checkpoint at step %d: %s\n", step, ip.checkpoint_file.c_str());
+        }
+
+        if (stop) {
+            if (rank == 0) printf("stopping at step %d\n", step);
+            break;
         }
     }
 
-    fftw_mpi_cleanup();
+    writer.close();
+    if (rank == 0) printf("output: %.2f s writing\n", writer.write_time());
+    if (rank == 0) printf("run: %.2f s\n", MPI_Wtime() - start_time);
+    if (rank == 0) printf("w transforms: %ld taken, %ld reused from the cache\n", w_spec.executed, w_spec.reused);
+    if (rank == 0 && load_steps > 0) 
+        printf("relaxation (%s): %ld iterations, %.1f per load step\n", ip.relaxation.c_str(), 
+               inner_iterations, inner_iterations/(double) load_steps);
+    delete engine;
+
+    FFTW(mpi_cleanup)();
     MPI_Finalize();
 
     return 0;
@@ -0,0 +1,489 @@
+
+#include "output.h"
+
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "h5_file.h"
+
+OutputFormat output_format(const std::string & format, int deflate)
+{
+    /**
+    @param format "double", "float" or "scale:D", scale-offset quantization 
+                  keeping D decimal digits (e.g. "scale:4")
+    @param deflate the deflate level (0-9) used with the format
+    **/
+
+    OutputFormat f;
+    f.single = false;
+    f.scale_digits = 0;
+    f.deflate = deflate;
+
+    if (deflate < 0 || deflate > 9) 
+        throw std::runtime_error("Deflate level must be between 0 and 9");
+
+    if (format == "double") return f;
+
+    if (format == "float") {
+        f.single = true;
+        return f;
+    }
+
+    if (format.compare(0, 6, "scale:") == 0) {
+        f.scale_digits = atoi(format.c_str() + 6);
+        if (f.scale_digits > 0) return f;
+    }
+
+    throw std::runtime_error("Unknown output format: " + format);
+}
+
+bool output_filtered(const OutputFormat & format)
+{
+    /**
+    True when format stores the data through hdf5 filters (scale-offset, deflate).
+    */
+
+    return format.scale_digits > 0 || format.deflate > 0;
+}
+
+bool parallel_output_available()
+{
+    /**
+    True when hdf5 was built with MPI-IO support.
+    */
+
+#ifdef H5_HAVE_PARALLEL
+    return true;
+#else
+    return false;
+#endif
+}
+
+void create_output(std::string filename, bool parallel_io, MPI_Comm comm)
+{
+    /**
+    Create (truncate) filename, collectively with parallel_io, otherwise on rank 0.
+    */
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    if (parallel_io) {
+#ifdef H5_HAVE_PARALLEL
+        H5File h5;
+        h5.open(filename, "w", comm);
+        h5.close();
+#endif
+    } else if (rank == 0) {
+        H5File h5;
+        h5.open(filename, "w");
+        h5.close();
+    }
+}
+
+void trim_output(std::string filename, int frame, bool parallel_io, MPI_Comm comm)
+{
+    /**
+    Remove the frames after frame from filename, they were written after the 
+    checkpoint a run is restarted from. The file is created if it is missing.
+    */
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    FILE * file_exists = fopen(filename.c_str(), "r");
+    if (file_exists == NULL) {
+        create_output(filename, parallel_io, comm);
+        return;
+    }
+    fclose(file_exists);
+
+    if (!parallel_io && rank != 0) return;
+
+    H5File h5;
+#ifdef H5_HAVE_PARALLEL
+    if (parallel_io) h5.open(filename, "a", comm);
+    else h5.open(filename, "a");
+#else
+    h5.open(filename, "a");
+#endif
+
+    const char * groups[6] = {"/eta0", "/eta1", "/eta2", "/w", "/ux", "/uy"};
+
+    for (int g=0; g<6; g++)
+    {
+        if (!h5.exists(groups[g])) continue;
+
+        std::vector<std::string> names;
+        h5.list(groups[g], names);
+
+        for (size_t n=0; n<names.size(); n++)
+            if (atoi(names[n].c_str()) > frame) h5.remove(std::string(groups[g]) + "/" + names[n]);
+    }
+
+    h5.close();
+}
+
+void output(std::string filename, std::string path, real * data, ptrdiff_t N0, ptrdiff_t N1, 
+            ptrdiff_t local_n0, ptrdiff_t local_0_start, bool parallel_io, int * chunk, 
+            const OutputFormat & format, MPI_Comm comm)
+// write the field data (local_n0 rows of the padded layout) to filename as an N0 x N1 dataset,
+// the padding columns of the r2c layout are skipped by the memory dataspace
+// with parallel_io every rank writes its own rows of the dataset in one collective MPI-IO write,
+// otherwise the rows are gathered on rank 0, which writes the whole dataset
+// chunk is the chunk shape of the dataset, NULL for the default layout
+// format is the precision and compression of the stored data, a compressed or quantized field 
+// is gathered on rank 0 also with parallel_io, hdf5 does not filter MPI-IO writes (output_filtered)
+{
+    int dims[2] = {(int) N0, (int) N1};
+
+#ifdef H5_HAVE_PARALLEL
+    if (parallel_io && !output_filtered(format)) {
+        int offset[2] = {(int) local_0_start, 0};
+        int count[2] = {(int) local_n0, (int) N1};
+        int mem_dims[2] = {(int) local_n0, (int) (2*(N1/2+1))};
+
+        H5File h5;
+        h5.open(filename, "a", comm);
+        h5.set_storage(format.single, format.scale_digits, format.deflate);
+        h5.write_dataset(path, data, dims, 2, offset, count, mem_dims, chunk);
+        h5.close();
+        return;
+    }
+#endif
+
+    int np, rank;
+    real * buffer;
+    int alloc_local = local_n0 * (N1/2+1);
+    int tag = 0;
+    MPI_Status status;
+
+    MPI_Comm_size(comm, &np);
+    MPI_Comm_rank(comm, &rank);
+
+    if ( rank == 0 ) {
+        buffer = new real [N0*2*(N1/2+1)];
+        memcpy(buffer, data, 2*alloc_local*sizeof(real));
+
+        // the slabs are ordered by rank but need not all have local_n0 rows
+        int received = 2*alloc_local;
+        for (int i=1; i<np; i++)
+        {
+            int count;
+            MPI_Probe(i, tag, comm, &status);
+            MPI_Get_count(&status, MPI_REAL_T, &count);
+            MPI_Recv(buffer + received, count, MPI_REAL_T, i, tag, comm, &status);
+            received += count;
+        }
+
+        int offset[2] = {0, 0};
+        int mem_dims[2] = {(int) N0, (int) (2*(N1/2+1))};
+
+        H5File h5;
+        h5.open(filename, "a");
+        h5.set_storage(format.single, format.scale_digits, format.deflate);
+        h5.write_dataset(path, buffer, dims, 2, offset, dims, mem_dims, chunk);
+        h5.close();
+
+        delete [] buffer;
+    } else {
+        MPI_Send(data, 2*alloc_local, MPI_REAL_T, 0, tag, comm);
+    }
+
+
+}
+
+OutputWriter :: OutputWriter(ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_0_start, 
+                             bool parallel_io, bool async, int chunk0, int chunk1)
+{
+    /**
+    @param async write the frames from a background thread, this needs MPI_THREAD_MULTIPLE
+    @param chunk0, chunk1 the chunk shape of the datasets, 0 for the default layout
+    **/
+
+    /**
+    In the asynchronous mode submit() only copies the fields into one of two 
+    staging frames, the gather, compression and hdf5 write of a frame happen 
+    in the writer thread while the solver continues with the next steps. 
+    The writer thread communicates on its own duplicate of MPI_COMM_WORLD, so its 
+    messages and collectives never match those of the solver.
+    The constructor is collective, out.h5 must have been created (create_output).
+    */
+
+    m_N0 = N0;
+    m_N1 = N1;
+    m_local_n0 = local_n0;
+    m_local_0_start = local_0_start;
+    m_parallel_io = parallel_io;
+    m_async = async;
+    m_stop = false;
+    m_next_submit = 0;
+    m_next_write = 0;
+    m_write_time = 0;
+    m_chunk[0] = chunk0;
+    m_chunk[1] = chunk1;
+
+    for (int f=0; f<2; f++) {
+        m_frames[f].nfields = 0;
+        m_frames[f].pending = false;
+    }
+
+    if (m_async) {
+        MPI_Comm_dup(MPI_COMM_WORLD, &m_comm);
+        pthread_mutex_init(&m_mutex, NULL);
+        pthread_cond_init(&m_cond, NULL);
+        pthread_create(&m_thread, NULL, run, this);
+    } else {
+        m_comm = MPI_COMM_WORLD;
+    }
+}
+
+void OutputWriter :: write_frame(Frame & frame)
+{
+    double start = MPI_Wtime();
+
+    try {
+        for (int n=0; n<frame.nfields; n++)
+            output("out.h5", frame.paths[n], frame.buffers[n], m_N0, m_N1, m_local_n0, m_local_0_start, m_parallel_io, 
+                   (m_chunk[0] > 0 && m_chunk[1] > 0) ? m_chunk : NULL, frame.formats[n], m_comm);
+    } catch (H5File::Error & e) {
+        fprintf(stderr, "output: %s\n", e.what());
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    m_write_time += MPI_Wtime() - start;
+}
+
+void * OutputWriter :: run(void * writer)
+{
+    /**
+    The writer thread, frames are written in the order they were submitted.
+    */
+
+    OutputWriter & w = *(OutputWriter *) writer;
+
+    pthread_mutex_lock(&w.m_mutex);
+
+    while (true)
+    {
+        Frame & frame = w.m_frames[w.m_next_write];
+
+        while (!frame.pending && !w.m_stop)
+            pthread_cond_wait(&w.m_cond, &w.m_mutex);
+
+        if (!frame.pending) break;
+
+        pthread_mutex_unlock(&w.m_mutex);
+        w.write_frame(frame);
+        pthread_mutex_lock(&w.m_mutex);
+
+        frame.pending = false;
+        w.m_next_write ^= 1;
+        pthread_cond_broadcast(&w.m_cond);
+    }
+
+    pthread_mutex_unlock(&w.m_mutex);
+    return NULL;
+}
+
+void OutputWriter :: submit(int nfields, const std::string * paths, real ** fields, const OutputFormat * formats)
+{
+    /**
+    @param paths the dataset names of the fields
+    @param fields the local fields (local_n0 rows of the padded layout)
+    @param formats how each field is stored
+    **/
+
+    /**
+    The fields can be changed as soon as submit returns. It only waits when 
+    both staging frames are still being written.
+    */
+
+    if (!m_async) {
+        Frame tmp;
+        tmp.nfields = nfields;
+        tmp.paths.assign(paths, paths + nfields);
+        tmp.buffers.assign(fields, fields + nfields);
+        tmp.formats.assign(formats, formats + nfields);
+        write_frame(tmp);
+        return;
+    }
+
+    Frame & frame = m_frames[m_next_submit];
+
+    pthread_mutex_lock(&m_mutex);
+    while (frame.pending)
+        pthread_cond_wait(&m_cond, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+
+    const ptrdiff_t size = m_local_n0 * 2*(m_N1/2+1);
+
+    while ((int) frame.buffers.size() < nfields)
+        frame.buffers.push_back(new real [size]);
+
+    frame.nfields = nfields;
+    frame.paths.assign(paths, paths + nfields);
+    frame.formats.assign(formats, formats + nfields);
+    for (int n=0; n<nfields; n++)
+        memcpy(frame.buffers[n], fields[n], size*sizeof(real));
+
+    pthread_mutex_lock(&m_mutex);
+    frame.pending = true;
+    m_next_submit ^= 1;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void OutputWriter :: flush()
+{
+    /**
+    Wait until all submitted frames are in out.h5.
+    */
+
+    if (!m_async) return;
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_frames[0].pending || m_frames[1].pending)
+        pthread_cond_wait(&m_cond, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void OutputWriter :: close()
+{
+    /**
+    Write the remaining frames and stop the writer thread, call before MPI_Finalize.
+    */
+
+    if (!m_async) return;
+
+    pthread_mutex_lock(&m_mutex);
+    m_stop = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_join(m_thread, NULL);
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+    MPI_Comm_free(&m_comm);
+
+    for (int f=0; f<2; f++)
+    for (size_t n=0; n<m_frames[f].buffers.size(); n++)
+        delete [] m_frames[f].buffers[n];
+
+    m_async = false;
+}
+
+void write_checkpoint(std::string filename, int nfields, const std::string * names, real ** fields, 
+                      int step, int frame, unsigned int * rng, int rng_size,
+                      ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_0_start, bool parallel_io)
+{
+    /**
+    @param names, fields the local fields of the solver state (local_n0 rows of the padded layout)
+    @param step, frame the last completed load step and output frame
+    @param rng, rng_size the state of the noise generator of this rank
+    **/
+
+    /**
+    The fields are stored as exact N0 x N1 values in the precision of the build, the generator states as an 
+    np x rng_size dataset with one row per rank, and the position in the run and the 
+    layout it was written with as attributes. The checkpoint is written to filename.tmp 
+    and renamed when it is complete, so an interrupted write never replaces the last 
+    good checkpoint.
+    */
+
+    int np, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    std::string tmp = filename + ".tmp";
+    OutputFormat exact = {false, 0, 0};
+
+    create_output(tmp, parallel_io, MPI_COMM_WORLD);
+
+    for (int n=0; n<nfields; n++)
+        output(tmp, names[n], fields[n], N0, N1, local_n0, local_0_start, parallel_io, NULL, exact, MPI_COMM_WORLD);
+
+    int rng_dims[2] = {np, rng_size};
+    unsigned int * all = NULL;
+
+    if (!parallel_io) {
+        if (rank == 0) all = new unsigned int [np*rng_size];
+        MPI_Gather(rng, rng_size, MPI_UNSIGNED, all, rng_size, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    }
+
+    if (parallel_io || rank == 0) {
+        H5File h5;
+#ifdef H5_HAVE_PARALLEL
+        if (parallel_io) h5.open(tmp, "a", MPI_COMM_WORLD);
+        else h5.open(tmp, "a");
+#else
+        h5.open(tmp, "a");
+#endif
+        h5.set_storage(false, 0, 0);
+
+        if (parallel_io) {
+            int offset[2] = {rank, 0};
+            int count[2] = {1, rng_size};
+            h5.write_dataset("rng", rng, rng_dims, 2, offset, count);
+        } else {
+            int offset[2] = {0, 0};
+            h5.write_dataset("rng", all, rng_dims, 2, offset, rng_dims);
+        }
+
+        h5.set_attribute("/step", step);
+        h5.set_attribute("/frame", frame);
+        h5.set_attribute("/Nx", (int) N0);
+        h5.set_attribute("/Ny", (int) N1);
+        h5.set_attribute("/np", np);
+        h5.close();
+    }
+
+    delete [] all;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) rename(tmp.c_str(), filename.c_str());
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void read_checkpoint(std::string filename, int nfields, const std::string * names, real ** fields, 
+                     int & step, int & frame, unsigned int * rng, int rng_size,
+                     ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_0_start)
+{
+    /**
+    The counterpart of write_checkpoint, every rank reads its own rows and 
+    generator state. The checkpoint must have been written with the same grid 
+    and number of ranks.
+    */
+
+    int np, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    H5File h5;
+    h5.open(filename, "r");
+
+    int Nx, Ny, np_written;
+    h5.get_attribute("/Nx", Nx);
+    h5.get_attribute("/Ny", Ny);
+    h5.get_attribute("/np", np_written);
+
+    if (Nx != N0 || Ny != N1 || np_written != np)
+        throw std::runtime_error("Checkpoint " + filename + " was written for a different grid or number of ranks");
+
+    int offset[2] = {(int) local_0_start, 0};
+    int count[2] = {(int) local_n0, (int) N1};
+    int mem_dims[2] = {(int) local_n0, (int) (2*(N1/2+1))};
+
+    for (int n=0; n<nfields; n++)
+        h5.read_dataset(names[n], fields[n], offset, count, mem_dims);
+
+    int rng_offset[2] = {rank, 0};
+    int rng_count[2] = {1, rng_size};
+    h5.read_dataset("rng", rng, rng_offset, rng_count);
+
+    h5.get_attribute("/step", step);
+    h5.get_attribute("/frame", frame);
+    h5.close();
+}
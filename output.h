@@ -0,0 +1,80 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <mpi.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "precision.h"
+
+// how a field is stored in out.h5
+struct OutputFormat {
+    bool single;        // 32 bit floats instead of doubles
+    int scale_digits;   // > 0: scale-offset quantization keeping this many decimal digits
+    int deflate;        // deflate level, 0 for no compression
+};
+
+OutputFormat output_format(const std::string & format, int deflate);
+bool output_filtered(const OutputFormat & format);
+
+bool parallel_output_available();
+void create_output(std::string filename, bool parallel_io, MPI_Comm comm);
+void trim_output(std::string filename, int frame, bool parallel_io, MPI_Comm comm);
+
+void output(std::string filename, std::string path, real * data, ptrdiff_t N0, ptrdiff_t N1, 
+            ptrdiff_t local_n0, ptrdiff_t local_0_start, bool parallel_io, int * chunk, 
+            const OutputFormat & format, MPI_Comm comm);
+
+// checkpoints hold the solver state, see write_checkpoint
+void write_checkpoint(std::string filename, int nfields, const std::string * names, real ** fields, 
+                      int step, int frame, unsigned int * rng, int rng_size,
+                      ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_0_start, bool parallel_io);
+void read_checkpoint(std::string filename, int nfields, const std::string * names, real ** fields, 
+                     int & step, int & frame, unsigned int * rng, int rng_size,
+                     ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_0_start);
+
+class OutputWriter {
+    private:
+        struct Frame {
+            int nfields;
+            std::vector<std::string> paths;
+            std::vector<real *> buffers;
+            std::vector<OutputFormat> formats;
+            bool pending;
+        };
+
+        ptrdiff_t m_N0, m_N1;
+        ptrdiff_t m_local_n0, m_local_0_start;
+        bool m_parallel_io;
+        bool m_async;
+        bool m_stop;
+        int m_next_submit;
+        int m_next_write;
+        double m_write_time;
+        int m_chunk[2];
+
+        MPI_Comm m_comm;
+        Frame m_frames[2];
+
+        pthread_t m_thread;
+        pthread_mutex_t m_mutex;
+        pthread_cond_t m_cond;
+
+        static void * run(void * writer);
+        void write_frame(Frame & frame);
+
+    public:
+        OutputWriter(ptrdiff_t N0, ptrdiff_t N1, ptrdiff_t local_n0, ptrdiff_t local_0_start, 
+                     bool parallel_io, bool async, int chunk0, int chunk1);
+
+        void submit(int nfields, const std::string * paths, real ** fields, const OutputFormat * formats);
+        void flush();
+        void close();
+
+        bool async() const { return m_async; }
+        double write_time() const { return m_write_time; }
+};
+
+#endif
@@ -33,6 +33,9 @@ class ParameterFile {
         template<typename T>
         void unpack( const std::string & name, T & parameter  ) const;
 
+        template<typename T>
+        void unpack( const std::string & name, T & parameter, const T & default_value ) const;
+
         template<typename T>
         void unpack( const std::string & name, std::vector<T> & vec  ) const;
 
@@ -64,6 +67,15 @@ void ParameterFile :: unpack( const std::string & name, T & parameter  ) const
     parameter = convertValueType<T>(it->second);
 }
 
+template<typename T>
+void ParameterFile :: unpack( const std::string & name, T & parameter, const T & default_value ) const
+{
+    // optional parameters fall back to the default when not found
+    std::map<std::string,std::string>::const_iterator it = params.find(name);
+    if (it == params.end()) parameter = default_value;
+    else parameter = convertValueType<T>(it->second);
+}
+
 template<typename T>
 void ParameterFile :: unpack( const std::string & name, std::vector<T> & vec  ) const
 {
@@ -0,0 +1,25 @@
+
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include <fftw3-mpi.h>
+#include <mpi.h>
+
+// Precision of the fields and transforms, double unless built with -DSINGLE_PRECISION 
+// (make single, links the fftw3f libraries). FFTW(name) selects the matching fftw or fftwf 
+// function or type, e.g. FFTW(plan), FFTW(complex), FFTW(execute)(plan).
+// Input parameters, reductions and timings stay double in both builds.
+
+#ifdef SINGLE_PRECISION
+typedef float real;
+#define FFTW(name) fftwf_ ## name
+#define MPI_REAL_T MPI_FLOAT
+#define PRECISION_NAME "single"
+#else
+typedef double real;
+#define FFTW(name) fftw_ ## name
+#define MPI_REAL_T MPI_DOUBLE
+#define PRECISION_NAME "double"
+#endif
+
+#endif
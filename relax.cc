@@ -0,0 +1,370 @@
+
+#include "relax.h"
+
+#include <mpi.h>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+RelaxationEngine :: RelaxationEngine(ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+{
+    m_local_n0 = local_n0;
+    m_N1 = N1;
+    m_threshold = 0.5*ip.M1_norm;
+
+    // the step a wave step from rest takes for the same chem, dtg2*dta2 in update_eta
+    m_res_scale = ip.dt*ip.dt*ip.alpha*ip.alpha/(1 + 0.5*ip.dt*ip.gamma);
+}
+
+double RelaxationEngine :: residual(Field2 chem)
+{
+    /**
+    The rms of chem over all ranks, scaled to the step the wave equation would take for it, 
+    so that it is compared with the same change_etap_thresh. The maximum would not do, the 
+    noise added to eta at every iteration keeps it above the threshold in a transformed state.
+    */
+
+    const int N1r = 2*(m_N1/2+1);
+    double sums[2] = {0, (double) (3*m_local_n0*m_N1)};
+    double r = 0;
+
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for reduction(+:r)
+        for (int i=0; i<m_local_n0; i++)
+        for (int j=0; j<m_N1; j++)
+            r += (double) chem[p][i*N1r + j]*chem[p][i*N1r + j];
+    }
+
+    sums[0] = r;
+    MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    return m_res_scale*std::sqrt(sums[0]/sums[1]);
+}
+
+double RelaxationEngine :: finish(Field2 eta, Field2 eta_old, const std::vector<real> & eta_new, double * area_count)
+{
+    /**
+    Move eta to eta_old and eta_new (compact, [(p*local_n0 + i)*N1 + j]) to eta,
+    returns the local maximum change and counts the transformed pixels.
+    */
+
+    const int N1r = 2*(m_N1/2+1);
+    double change = 0;
+    double count = 0;
+
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for reduction(max:change) reduction(+:count)
+        for (int i=0; i<m_local_n0; i++)
+        for (int j=0; j<m_N1; j++)
+        {
+            int ndx = i*N1r + j;
+            double e = eta_new[(p*m_local_n0 + i)*m_N1 + j];
+
+            change = std::max(change, std::fabs(e - eta[p][ndx]));
+            count += std::fabs(e) > m_threshold ? 1 : 0;
+
+            eta_old[p][ndx] = eta[p][ndx];
+            eta[p][ndx] = e;
+        }
+    }
+
+    *area_count = count;
+    return change;
+}
+
+FireEngine :: FireEngine(ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+    : RelaxationEngine(local_n0, N1, ip)
+{
+    /**
+    The initial time step dt*alpha is the step of the wave equation, 
+    it can grow up to fire_dt_max times that.
+    */
+
+    m_v.resize(3*local_n0*N1);
+    m_eta_new.resize(3*local_n0*N1);
+
+    m_dt0 = ip.dt*ip.alpha;
+    m_dt_max = ip.fire_dt_max*m_dt0;
+
+    reset();
+}
+
+void FireEngine :: reset()
+{
+    std::fill(m_v.begin(), m_v.end(), 0.0);
+    m_dt = m_dt0;
+    m_alpha = 0.1;
+    m_npos = 0;
+}
+
+double FireEngine :: update(Field2 eta, Field2 eta_old, Field2 chem, double * area_count)
+{
+    const int N1r = 2*(m_N1/2+1);
+
+    const int n_delay = 5;
+    const double f_inc = 1.1;
+    const double f_dec = 0.5;
+    const double f_alpha = 0.99;
+    const double alpha_start = 0.1;
+
+    // the power F.v and the norms of the force F = -chem and the velocity
+    double sums[3] = {0, 0, 0};
+    double P = 0, FF = 0, vv = 0;
+
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for reduction(+:P,FF,vv)
+        for (int i=0; i<m_local_n0; i++)
+        for (int j=0; j<m_N1; j++)
+        {
+            double F = -chem[p][i*N1r + j];
+            double v = m_v[(p*m_local_n0 + i)*m_N1 + j];
+            P += F*v;
+            FF += F*F;
+            vv += v*v;
+        }
+    }
+
+    sums[0] = P; sums[1] = FF; sums[2] = vv;
+    MPI_Allreduce(MPI_IN_PLACE, sums, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    // at rest (the first iteration of a load step) there is nothing to stop
+    bool downhill = sums[0] > 0 || sums[2] == 0;
+    double mix = sums[1] > 0 ? m_alpha*std::sqrt(sums[2]/sums[1]) : 0;
+    double dt_prev = m_dt;
+
+    if (downhill) {
+        if (++m_npos > n_delay) {
+            m_dt = std::min(m_dt*f_inc, m_dt_max);
+            m_alpha *= f_alpha;
+        }
+    } else {
+        m_npos = 0;
+        m_dt *= f_dec;
+        m_alpha = alpha_start;
+    }
+
+    const double dt = m_dt;
+    const double alpha = m_alpha;
+
+    // mix the velocity towards the force (or step back half a step and stop when going uphill), 
+    // then a semi-implicit Euler step
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for
+        for (int i=0; i<m_local_n0; i++)
+        for (int j=0; j<m_N1; j++)
+        {
+            int k = (p*m_local_n0 + i)*m_N1 + j;
+            double F = -chem[p][i*N1r + j];
+            double x = eta[p][i*N1r + j];
+            double v = m_v[k];
+
+            if (downhill) {
+                v = (1-alpha)*v + mix*F;
+            } else {
+                x -= 0.5*dt_prev*v;
+                v = 0;
+            }
+
+            v += dt*F;
+            m_v[k] = v;
+            m_eta_new[k] = x + dt*v;
+        }
+    }
+
+    // converged once the residual is small and eta has stopped moving, the residual alone 
+    // is small while a transformed domain is still growing, the change alone while the 
+    // time step has been cut after going uphill
+    double res = residual(chem);
+    return std::max(res, finish(eta, eta_old, m_eta_new, area_count));
+}
+
+AndersonEngine :: AndersonEngine(ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip)
+    : RelaxationEngine(local_n0, N1, ip)
+{
+    /**
+    The gradient step tau = (dt*alpha)^2 is the step of the wave equation without inertia, 
+    anderson_mixing scales it in the combined update.
+    */
+
+    const size_t n = 3*local_n0*N1;
+
+    m_depth = ip.anderson_depth;
+    m_tau = ip.dt*ip.dt*ip.alpha*ip.alpha;
+    m_beta = ip.anderson_mixing;
+
+    m_x_prev.resize(n);
+    m_f_prev.resize(n);
+    m_f.resize(n);
+    m_eta_new.resize(n);
+    m_dx.resize(m_depth, std::vector<real>(n));
+    m_df.resize(m_depth, std::vector<real>(n));
+    m_A.resize(m_depth*m_depth);
+
+    reset();
+}
+
+void AndersonEngine :: reset()
+{
+    m_count = -1;
+    m_f2_prev = 0;
+}
+
+double AndersonEngine :: update(Field2 eta, Field2 eta_old, Field2 chem, double * area_count)
+{
+    const int N1r = 2*(m_N1/2+1);
+    const ptrdiff_t n = 3*m_local_n0*m_N1;
+    const int m = m_depth;
+
+    // the gradient step f = -tau*chem and the differences to the previous iterate
+    int col = m_count >= 0 ? m_count % m : 0;
+
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for
+        for (int i=0; i<m_local_n0; i++)
+        for (int j=0; j<m_N1; j++)
+        {
+            int k = (p*m_local_n0 + i)*m_N1 + j;
+            double x = eta[p][i*N1r + j];
+            double f = -m_tau*chem[p][i*N1r + j];
+
+            if (m_count >= 0) {
+                m_dx[col][k] = x - m_x_prev[k];
+                m_df[col][k] = f - m_f_prev[k];
+            }
+
+            m_x_prev[k] = x;
+            m_f_prev[k] = f;
+            m_f[k] = f;
+        }
+    }
+
+    m_count++;
+    int mk = std::min(m_count, m);
+
+    // the products of the new difference with the history, and of the history with f
+    std::vector<double> dots(2*mk + 1, 0.0);
+
+    for (int c=0; c<mk; c++)
+    {
+        const real * dfc = &m_df[c][0];
+        const real * dfn = &m_df[col][0];
+        const real * f = &m_f[0];
+        double a = 0, b = 0;
+
+        #pragma omp parallel for reduction(+:a,b)
+        for (ptrdiff_t k=0; k<n; k++) {
+            a += dfn[k]*dfc[k];
+            b += dfc[k]*f[k];
+        }
+
+        dots[c] = a;
+        dots[mk + c] = b;
+    }
+
+    double f2 = 0;
+    #pragma omp parallel for reduction(+:f2)
+    for (ptrdiff_t k=0; k<n; k++) f2 += m_f[k]*m_f[k];
+    dots[2*mk] = f2;
+
+    MPI_Allreduce(MPI_IN_PLACE, &dots[0], 2*mk + 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    // a growing residual means the history no longer describes the problem (noise, new load), 
+    // start again with a plain gradient step
+    const double f2_all = dots[2*mk];
+
+    if (m_f2_prev > 0 && f2_all > 4*m_f2_prev) {
+        m_count = 0;
+        mk = 0;
+    }
+    m_f2_prev = f2_all;
+
+    for (int c=0; c<mk; c++) {
+        m_A[col*m + c] = dots[c];
+        m_A[c*m + col] = dots[c];
+    }
+
+    // solve the regularized normal equations (A + reg) gamma = b by gaussian elimination
+    std::vector<double> M(mk*mk), gamma(mk);
+    double trace = 0;
+    for (int c=0; c<mk; c++) trace += m_A[c*m + c];
+
+    for (int r=0; r<mk; r++) {
+        for (int c=0; c<mk; c++) M[r*mk + c] = m_A[r*m + c];
+        M[r*mk + r] += 1e-10*trace/mk;
+        gamma[r] = dots[mk + r];
+    }
+
+    for (int r=0; r<mk; r++)
+    {
+        int pivot = r;
+        for (int q=r+1; q<mk; q++) if (std::fabs(M[q*mk + r]) > std::fabs(M[pivot*mk + r])) pivot = q;
+        for (int c=0; c<mk; c++) std::swap(M[r*mk + c], M[pivot*mk + c]);
+        std::swap(gamma[r], gamma[pivot]);
+
+        if (M[r*mk + r] == 0) continue;
+
+        for (int q=r+1; q<mk; q++) {
+            double factor = M[q*mk + r]/M[r*mk + r];
+            for (int c=r; c<mk; c++) M[q*mk + c] -= factor*M[r*mk + c];
+            gamma[q] -= factor*gamma[r];
+        }
+    }
+
+    for (int r=mk-1; r>=0; r--) {
+        for (int c=r+1; c<mk; c++) gamma[r] -= M[r*mk + c]*gamma[c];
+        gamma[r] = M[r*mk + r] != 0 ? gamma[r]/M[r*mk + r] : 0;
+    }
+
+    // eta_new = x + beta*f - sum_c gamma_c (dx_c + beta*df_c)
+    const double beta = m_beta;
+
+    for (int p=0; p<3; p++)
+    {
+        #pragma omp parallel for
+        for (int i=0; i<m_local_n0; i++)
+        for (int j=0; j<m_N1; j++)
+        {
+            int k = (p*m_local_n0 + i)*m_N1 + j;
+            double e = m_x_prev[k] + beta*m_f[k];
+
+            for (int c=0; c<mk; c++)
+                e -= gamma[c]*(m_dx[c][k] + beta*m_df[c][k]);
+
+            m_eta_new[k] = e;
+        }
+    }
+
+    // the mixed step has to go downhill, near a saddle (a nucleus that has not grown yet) it 
+    // would lead back to the saddle, take the plain gradient step then and start a new history
+    double down = 0;
+    #pragma omp parallel for reduction(+:down)
+    for (ptrdiff_t k=0; k<n; k++) down += (m_eta_new[k] - m_x_prev[k])*m_f[k];
+
+    MPI_Allreduce(MPI_IN_PLACE, &down, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    if (mk > 0 && down <= 0) {
+        #pragma omp parallel for
+        for (ptrdiff_t k=0; k<n; k++) m_eta_new[k] = m_x_prev[k] + beta*m_f[k];
+        m_count = 0;
+    }
+
+    // the same convergence measure as FireEngine
+    double res = residual(chem);
+    return std::max(res, finish(eta, eta_old, m_eta_new, area_count));
+}
+
+RelaxationEngine * create_relaxation_engine(const std::string & name, ptrdiff_t local_n0, ptrdiff_t N1, 
+                                            const struct input_parameters & ip)
+{
+    // the wave equation and the semi-implicit step are fused with the transforms in main
+    if (name == "wave" || name == "semi_implicit") return NULL;
+    if (name == "fire")     return new FireEngine(local_n0, N1, ip);
+    if (name == "anderson") return new AndersonEngine(local_n0, N1, ip);
+
+    throw std::runtime_error("Unknown relaxation: " + name);
+}
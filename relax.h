@@ -0,0 +1,87 @@
+
+#ifndef RELAX_H
+#define RELAX_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "input_parameters.h"
+#include "field.h"
+
+// Relaxation engines for the inner loop of a load step. They move eta downhill using the 
+// chemical potential chem = dF/deta of the current eta as the residual. The default damped 
+// wave equation (relaxation = wave) is fused with the chemical potential in update_eta 
+// and has no engine. Engines are reset at every load step, so their state never has to 
+// be checkpointed.
+//
+// An engine only moves eta downhill, it never climbs a nucleation barrier the way the 
+// inertia and the noise of the wave equation do, so the inner loop keeps the wave steps 
+// until some of the area has transformed in the load step and the transformed area has 
+// stopped changing, and hands the rest to the engine.
+
+class RelaxationEngine {
+    protected:
+        ptrdiff_t m_local_n0, m_N1;
+        double m_threshold;
+        double m_res_scale;
+
+        double residual(Field2 chem);
+        double finish(Field2 eta, Field2 eta_old, const std::vector<real> & eta_new, double * area_count);
+
+    public:
+        RelaxationEngine(ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip);
+        virtual ~RelaxationEngine() {}
+
+        // start a new load step
+        virtual void reset() = 0;
+
+        // step eta (the previous eta goes to eta_old), returns the local convergence measure, 
+        // area_count is the local number of transformed pixels
+        virtual double update(Field2 eta, Field2 eta_old, Field2 chem, double * area_count) = 0;
+};
+
+// fast inertial relaxation (Bitzek et al. 2006), the velocity is mixed towards the force 
+// and the time step grows while the motion is downhill, it stops and restarts otherwise
+class FireEngine : public RelaxationEngine {
+    private:
+        std::vector<real> m_v;
+        std::vector<real> m_eta_new;
+
+        double m_dt0, m_dt, m_dt_max;
+        double m_alpha;
+        int m_npos;
+
+    public:
+        FireEngine(ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip);
+
+        void reset();
+        double update(Field2 eta, Field2 eta_old, Field2 chem, double * area_count);
+};
+
+// Anderson acceleration of the gradient step eta - tau*chem, the new eta combines the 
+// last depth steps so that the linearized residual is smallest
+class AndersonEngine : public RelaxationEngine {
+    private:
+        int m_depth;
+        int m_count;
+        double m_tau, m_beta;
+        double m_f2_prev;
+
+        std::vector<real> m_x_prev, m_f_prev, m_f;
+        std::vector< std::vector<real> > m_dx, m_df;
+        std::vector<double> m_A;
+        std::vector<real> m_eta_new;
+
+    public:
+        AndersonEngine(ptrdiff_t local_n0, ptrdiff_t N1, const struct input_parameters & ip);
+
+        void reset();
+        double update(Field2 eta, Field2 eta_old, Field2 chem, double * area_count);
+};
+
+// NULL for relaxation = wave and semi_implicit
+RelaxationEngine * create_relaxation_engine(const std::string & name, ptrdiff_t local_n0, ptrdiff_t N1, 
+                                            const struct input_parameters & ip);
+
+#endif
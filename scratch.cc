@@ -0,0 +1,90 @@
+
+#include "scratch.h"
+#include "field.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+ScratchPlanner::~ScratchPlanner()
+{
+    free(m_block);
+}
+
+void ScratchPlanner::allocate()
+{
+    /**
+    Assign the offsets of the buffers in the shared block, largest first, each at the lowest
+    offset that does not overlap a buffer already placed and live at one of the same stages.
+    Greedy placement is not optimal in general, but with a few buffer sizes that are multiples 
+    of a field it stays close to the memory live at the busiest stage. Offsets are kept on 64 
+    byte boundaries like the tensor fields, which also meets the alignment fftw looks for.
+    */
+
+    std::vector<int> order(m_buffers.size());
+    for (size_t n=0; n<order.size(); n++) order[n] = n;
+
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return m_buffers[a].bytes > m_buffers[b].bytes;
+    });
+
+    m_bytes = 0;
+    std::vector<int> placed;
+    for (size_t n=0; n<order.size(); n++)
+    {
+        Buffer & b = m_buffers[order[n]];
+        size_t size = (b.bytes + field_alignment - 1)/field_alignment*field_alignment;
+
+        // the ranges taken by the live buffers, in order of their offsets
+        std::vector<std::pair<size_t, size_t> > taken;
+        for (size_t m=0; m<placed.size(); m++)
+        {
+            const Buffer & o = m_buffers[placed[m]];
+            if (o.first <= b.last && b.first <= o.last)
+                taken.push_back(std::make_pair(o.offset, o.offset + o.bytes));
+        }
+        std::sort(taken.begin(), taken.end());
+
+        size_t offset = 0;
+        for (size_t m=0; m<taken.size(); m++)
+        {
+            if (offset + size <= taken[m].first) break;
+            offset = std::max(offset, (taken[m].second + field_alignment - 1)/field_alignment*field_alignment);
+        }
+
+        b.offset = offset;
+        m_bytes = std::max(m_bytes, offset + size);
+        placed.push_back(order[n]);
+    }
+
+    free(m_block);
+    m_block = NULL;
+
+    size_t alignment = m_bytes >= field_huge_page ? field_huge_page : field_alignment;
+    void * ptr = NULL;
+    if (m_bytes > 0 && posix_memalign(&ptr, alignment, m_bytes) != 0) throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (m_bytes >= field_huge_page) madvise(ptr, m_bytes, MADV_HUGEPAGE);
+#endif
+    m_block = (char *) ptr;
+
+    for (size_t n=0; n<m_buffers.size(); n++)
+        m_buffers[n].assign(m_block + m_buffers[n].offset);
+}
+
+size_t ScratchPlanner::unaliased_bytes() const
+{
+    // the memory the buffers would take each on their own
+    size_t sum = 0;
+    for (size_t n=0; n<m_buffers.size(); n++) sum += m_buffers[n].bytes;
+    return sum;
+}
+
+void ScratchPlanner::print_layout(FILE * fp) const
+{
+    for (size_t n=0; n<m_buffers.size(); n++)
+    {
+        const Buffer & b = m_buffers[n];
+        fprintf(fp, "    %-10s %9.1f MB at %9.1f MB, stages %d-%d\n", b.name.c_str(),
+                b.bytes/1048576.0, b.offset/1048576.0, b.first, b.last);
+    }
+}
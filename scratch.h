@@ -0,0 +1,53 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Scratch memory of the solver iteration. Every buffer is registered with the first and the
+// last stage of an iteration at which it is live, buffers that are never live at the same stage
+// share memory. The buffers are carved out of one block by allocate(), which has to happen
+// before the fftw plans are made, so the plans are bound to the shared memory. Scratch buffers
+// must not carry anything from one iteration to the next, the solver state stays in its own fields.
+
+class ScratchPlanner {
+    private:
+        struct Buffer {
+            std::string name;
+            size_t bytes;
+            int first, last;
+            size_t offset;
+            std::function<void (char *)> assign;
+        };
+
+        std::vector<Buffer> m_buffers;
+        char * m_block;
+        size_t m_bytes;
+
+        // a scratch block is assigned once, the pointers handed out stay valid for the whole run
+        ScratchPlanner(const ScratchPlanner &);
+        ScratchPlanner & operator= (const ScratchPlanner &);
+
+    public:
+        ScratchPlanner() : m_block(NULL), m_bytes(0) {}
+        ~ScratchPlanner();
+
+        // ptr is set to count elements of T by allocate()
+        template <typename T>
+        void add(const std::string & name, T ** ptr, size_t count, int first, int last)
+        {
+            Buffer b = {name, count*sizeof(T), first, last, 0, [ptr](char * p) { *ptr = (T *) p; }};
+            m_buffers.push_back(b);
+        }
+
+        void allocate();
+
+        size_t bytes() const { return m_bytes; }
+        size_t unaliased_bytes() const;
+        void print_layout(FILE * fp) const;
+};
+
+#endif
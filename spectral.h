@@ -0,0 +1,42 @@
+
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+#include <stddef.h>
+#include "precision.h"
+
+// A real-space field together with its forward transform, so that a field read in k-space by
+// several stages is transformed once per change instead of once per reader. Every write to the
+// real-space data is followed by touch(), which bumps its version, and transform() only executes
+// the plan when the transform in k was taken from an older version.
+//
+// k keeps the transform from one write to the next, so it is a buffer of its own and not part
+// of the scratch block (scratch.h), whose buffers are reused by the other stages.
+
+struct SpectralField {
+    real * r;                   // the real-space field, input of plan
+    FFTW(complex) * k;          // its transform, output of plan
+    FFTW(plan) plan;
+
+    unsigned long version;      // of the real-space data
+    unsigned long k_version;    // of the data k was transformed from
+    long executed, reused;      // transform() calls that ran the plan or returned k as it was
+
+    SpectralField() : r(NULL), k(NULL), plan(NULL), version(1), k_version(0), executed(0), reused(0) {}
+
+    // the real-space data has been written
+    void touch() { version++; }
+
+    const FFTW(complex) * transform()
+    {
+        if (k_version != version) {
+            FFTW(execute)(plan);
+            k_version = version;
+            executed++;
+        }
+        else reused++;
+        return k;
+    }
+};
+
+#endif
@@ -0,0 +1,97 @@
+
+# Compare the single precision build (make single) with the double build on the
+# reference case in input.txt, run by both with the same fixed noise seed (--seed):
+# run time, inner iterations and the difference of the results.
+# Run from the repository root: python tools/bench_precision.py [--np 4] [--no-build]
+
+import argparse
+import os
+import re
+import shlex
+import shutil
+import subprocess
+import time
+
+import numpy as np
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--np", type=int, default=1, help="MPI ranks")
+parser.add_argument("--mpirun", default="mpirun", help="launcher command, e.g. \"mpirun --bind-to core\"")
+parser.add_argument("--input", default="input.txt")
+parser.add_argument("--seed", type=int, default=1, help="noise seed written into both inputs (nonzero)")
+parser.add_argument("--no-build", action="store_true")
+args = parser.parse_args()
+
+if args.seed == 0: parser.error("--seed must be nonzero, seed = 0 seeds the noise from the clock")
+
+# both builds get the same noise, so the differences are rounding and not the random state
+with open(args.input, newline="") as f: input_text = f.read()
+seed_line = re.compile(r"^seed\s*=.*?(\r?)$", re.MULTILINE)
+if seed_line.search(input_text):
+    input_text = seed_line.sub(lambda m: "seed = %d%s" % (args.seed, m.group(1)), input_text)
+else:
+    input_text += "\nseed = %d\n" % args.seed
+
+builds = [("double", "a.out", "default"), ("single", "a_single.out", "single")]
+root = os.getcwd()
+results = {}
+
+for name, binary, target in builds:
+
+    if not args.no_build:
+        subprocess.check_call(["make", target])
+
+    # each build runs in its own directory, input.txt and out.h5 are relative to it
+    run_dir = os.path.join(root, "bench_" + name)
+    if os.path.exists(run_dir): shutil.rmtree(run_dir)
+    os.makedirs(run_dir)
+    with open(os.path.join(run_dir, "input.txt"), "w", newline="") as f: f.write(input_text)
+
+    start = time.time()
+    log = subprocess.check_output(shlex.split(args.mpirun) + ["-np", str(args.np), os.path.join(root, binary)],
+                                  cwd=run_dir, universal_newlines=True)
+    wall = time.time() - start
+
+    with open(os.path.join(run_dir, "log.txt"), "w") as f: f.write(log)
+
+    iterations = re.search(r"relaxation \(\w+\): (\d+) iterations", log)
+    run_time = re.search(r"run: ([\d.]+) s", log)
+
+    results[name] = {
+        "dir": run_dir,
+        "wall": wall,
+        "run": float(run_time.group(1)) if run_time else wall,
+        "iterations": int(iterations.group(1)) if iterations else 0,
+        "area": np.loadtxt(os.path.join(run_dir, "area_fraction.dat"), ndmin=2)
+    }
+
+d = results["double"]
+s = results["single"]
+
+print("")
+print("%-8s %10s %10s %12s" % ("build", "run [s]", "wall [s]", "iterations"))
+for name in ["double", "single"]:
+    r = results[name]
+    print("%-8s %10.2f %10.2f %12d" % (name, r["run"], r["wall"], r["iterations"]))
+print("speedup: %.2fx" % (d["run"]/s["run"]))
+
+# the load steps both runs completed
+n = min(len(d["area"]), len(s["area"]))
+print("area fraction: max difference %.3e over %d load steps" %
+      (np.max(np.abs(d["area"][:n,1] - s["area"][:n,1])), n))
+
+# the last frame both runs wrote
+try:
+    import h5py
+except ImportError:
+    print("h5py not available, the output frames are not compared")
+    raise SystemExit
+
+with h5py.File(os.path.join(d["dir"], "out.h5"), "r") as hd, h5py.File(os.path.join(s["dir"], "out.h5"), "r") as hs:
+    for field in ["eta0", "eta1", "eta2", "w"]:
+        frames = sorted(set(hd[field].keys()) & set(hs[field].keys()))
+        if not frames: continue
+        a = hd[field][frames[-1]][...]
+        b = hs[field][frames[-1]][...]
+        print("%s/%s: max difference %.3e (max |%s| %.3e)" %
+              (field, frames[-1], np.max(np.abs(a - b)), field, np.max(np.abs(a))))
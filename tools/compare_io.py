@@ -0,0 +1,99 @@
+
+# Check that the collective MPI-IO output (parallel_io = 1) and the output gathered on
+# rank 0 (parallel_io = 0) read back identically: the same datasets with the same values,
+# type, chunking and filters. Both runs use the input in input.txt with the same fixed
+# noise seed (--seed), so they compute the same fields, and out_deflate = --deflate
+# (0 by default, compressed fields are gathered on rank 0 also with parallel_io).
+# Run from the repository root: python tools/compare_io.py [--np 2] [--no-build]
+
+import argparse
+import os
+import re
+import shlex
+import shutil
+import subprocess
+import sys
+
+import h5py
+import numpy as np
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--np", type=int, default=2, help="MPI ranks, more than one so that every rank writes a slab")
+parser.add_argument("--mpirun", default="mpirun", help="launcher command, e.g. \"mpirun --bind-to core\"")
+parser.add_argument("--input", default="input.txt")
+parser.add_argument("--seed", type=int, default=1, help="noise seed written into both inputs (nonzero)")
+parser.add_argument("--deflate", type=int, default=0, help="out_deflate of both runs")
+parser.add_argument("--binary", default="a.out")
+parser.add_argument("--no-build", action="store_true")
+args = parser.parse_args()
+
+if args.seed == 0: parser.error("--seed must be nonzero, seed = 0 seeds the noise from the clock")
+
+def set_key(text, key, value):
+    # replace the key in place (keeping the line ending of input.txt) or append it
+    line = re.compile(r"^%s\s*=.*?(\r?)$" % key, re.MULTILINE)
+    if line.search(text):
+        return line.sub(lambda m: "%s = %s%s" % (key, value, m.group(1)), text)
+    return text + "\n%s = %s\n" % (key, value)
+
+with open(args.input, newline="") as f: input_text = f.read()
+input_text = set_key(input_text, "seed", args.seed)
+input_text = set_key(input_text, "out_deflate", args.deflate)
+
+if not args.no_build:
+    subprocess.check_call(["make", "default"])
+
+root = os.getcwd()
+files = {}
+
+for parallel_io in [0, 1]:
+
+    # each run in its own directory, input.txt and out.h5 are relative to it
+    run_dir = os.path.join(root, "io_parallel_%d" % parallel_io)
+    if os.path.exists(run_dir): shutil.rmtree(run_dir)
+    os.makedirs(run_dir)
+    with open(os.path.join(run_dir, "input.txt"), "w", newline="") as f:
+        f.write(set_key(input_text, "parallel_io", parallel_io))
+
+    log = subprocess.check_output(shlex.split(args.mpirun) + ["-np", str(args.np), os.path.join(root, args.binary)],
+                                  cwd=run_dir, universal_newlines=True)
+
+    with open(os.path.join(run_dir, "log.txt"), "w") as f: f.write(log)
+
+    if parallel_io and "parallel hdf5" not in log:
+        print("hdf5 has no MPI-IO support, both runs were gathered on rank 0")
+
+    files[parallel_io] = os.path.join(run_dir, "out.h5")
+
+def datasets(h5):
+    names = []
+    h5.visititems(lambda name, obj: names.append(name) if isinstance(obj, h5py.Dataset) else None)
+    return set(names)
+
+def layout(d):
+    return (d.shape, d.dtype.str, d.chunks, d.compression, d.compression_opts, d.shuffle, d.scaleoffset)
+
+mismatches = 0
+
+with h5py.File(files[0], "r") as hs, h5py.File(files[1], "r") as hp:
+    names_s = datasets(hs)
+    names_p = datasets(hp)
+
+    for name in sorted(names_s ^ names_p):
+        print("%s: only in %s" % (name, "gathered" if name in names_s else "parallel"))
+        mismatches += 1
+
+    for name in sorted(names_s & names_p):
+        ds = hs[name]
+        dp = hp[name]
+
+        if layout(ds) != layout(dp):
+            print("%s: layout %s gathered, %s parallel" % (name, layout(ds), layout(dp)))
+            mismatches += 1
+        elif not np.array_equal(ds[...], dp[...]):
+            print("%s: max difference %.3e" % (name, np.max(np.abs(ds[...] - dp[...]))))
+            mismatches += 1
+
+    print("%d datasets compared, %d differ" % (len(names_s & names_p), mismatches))
+
+sys.exit(1 if mismatches else 0)
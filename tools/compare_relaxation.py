@@ -0,0 +1,89 @@
+# Compare the inner relaxation schemes (relaxation = wave, semi_implicit, ...) on the
+# reference case in input.txt, run by each with the same fixed noise seed (--seed):
+# inner iterations to convergence, run time and the difference of the area fraction
+# against the first scheme (wave by default).
+# Run from the repository root: python tools/compare_relaxation.py [--np 4] [--no-build]
+#     [--schemes wave semi_implicit fire] [--set semi_implicit_dt=2 ...]
+
+import argparse
+import os
+import re
+import shlex
+import shutil
+import subprocess
+import time
+
+import numpy as np
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--np", type=int, default=1, help="MPI ranks")
+parser.add_argument("--mpirun", default="mpirun", help="launcher command, e.g. \"mpirun --bind-to core\"")
+parser.add_argument("--input", default="input.txt")
+parser.add_argument("--seed", type=int, default=1, help="noise seed written into all inputs (nonzero)")
+parser.add_argument("--schemes", nargs="+", default=["wave", "semi_implicit"],
+                    help="relaxation schemes, the first one is the reference")
+parser.add_argument("--set", nargs="*", default=[], metavar="KEY=VALUE",
+                    help="further input keys for all runs, e.g. semi_implicit_stab=1")
+parser.add_argument("--binary", default="a.out")
+parser.add_argument("--no-build", action="store_true")
+args = parser.parse_args()
+
+if args.seed == 0: parser.error("--seed must be nonzero, seed = 0 seeds the noise from the clock")
+
+def set_key(text, key, value):
+    # replace the key in place (keeping the line ending of input.txt) or append it
+    line = re.compile(r"^%s\s*=.*?(\r?)$" % key, re.MULTILINE)
+    if line.search(text):
+        return line.sub(lambda m: "%s = %s%s" % (key, value, m.group(1)), text)
+    return text + "\n%s = %s\n" % (key, value)
+
+# all schemes get the same noise, so the differences come from the relaxation alone
+with open(args.input, newline="") as f: input_text = f.read()
+input_text = set_key(input_text, "seed", args.seed)
+for kv in args.set:
+    key, value = kv.split("=", 1)
+    input_text = set_key(input_text, key.strip(), value.strip())
+
+if not args.no_build:
+    subprocess.check_call(["make", "default"])
+
+root = os.getcwd()
+results = {}
+
+for scheme in args.schemes:
+
+    # each scheme runs in its own directory, input.txt and out.h5 are relative to it
+    run_dir = os.path.join(root, "relax_" + scheme)
+    if os.path.exists(run_dir): shutil.rmtree(run_dir)
+    os.makedirs(run_dir)
+    with open(os.path.join(run_dir, "input.txt"), "w", newline="") as f:
+        f.write(set_key(input_text, "relaxation", scheme))
+
+    start = time.time()
+    log = subprocess.check_output(shlex.split(args.mpirun) + ["-np", str(args.np), os.path.join(root, args.binary)],
+                                  cwd=run_dir, universal_newlines=True)
+    wall = time.time() - start
+
+    with open(os.path.join(run_dir, "log.txt"), "w") as f: f.write(log)
+
+    iterations = re.search(r"relaxation \(\w+\): (\d+) iterations, ([\d.]+) per load step", log)
+    run_time = re.search(r"run: ([\d.]+) s", log)
+
+    results[scheme] = {
+        "run": float(run_time.group(1)) if run_time else wall,
+        "iterations": int(iterations.group(1)) if iterations else 0,
+        "per_step": float(iterations.group(2)) if iterations else 0.0,
+        "area": np.loadtxt(os.path.join(run_dir, "area_fraction.dat"), ndmin=2)
+    }
+
+ref = results[args.schemes[0]]
+
+print("")
+print("%-14s %12s %10s %10s %10s %14s" % ("relaxation", "iterations", "per step", "ratio", "run [s]", "max dAf"))
+for scheme in args.schemes:
+    r = results[scheme]
+    # the load steps both runs completed
+    n = min(len(ref["area"]), len(r["area"]))
+    d_area = np.max(np.abs(ref["area"][:n,1] - r["area"][:n,1])) if n else float("nan")
+    print("%-14s %12d %10.1f %10.2f %10.2f %14.3e" % (scheme, r["iterations"], r["per_step"],
+          r["iterations"]/float(ref["iterations"]) if ref["iterations"] else float("nan"), r["run"], d_area))
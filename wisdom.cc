@@ -0,0 +1,60 @@
+
+#include "wisdom.h"
+
+#include <sstream>
+#include <stdexcept>
+
+unsigned planner_flags(const std::string & planner)
+{
+    /**
+    Map the planner name from the input file to the fftw planner flags.
+    Every plan in the run is created with the same rigor.
+    */
+
+    if (planner == "estimate")   return FFTW_ESTIMATE;
+    if (planner == "measure")    return FFTW_MEASURE;
+    if (planner == "patient")    return FFTW_PATIENT;
+    if (planner == "exhaustive") return FFTW_EXHAUSTIVE;
+
+    throw std::runtime_error("Unknown fftw_planner: " + planner);
+}
+
+std::string wisdom_filename(const std::string & dir, int Nx, int Ny, int np, int nthreads, const std::string & planner)
+{
+    /**
+    Wisdom is only valid for the grid size, the number of ranks and threads, the
+    planner rigor and the precision it was gathered with, so all of them are part of the file name.
+    */
+
+    std::stringstream ss;
+    ss << dir << "/wisdom_" << Nx << "x" << Ny << "_np" << np << "_nt" << nthreads << "_" << planner 
+       << (sizeof(real) == sizeof(float) ? ".fftwf" : ".fftw");
+    return ss.str();
+}
+
+bool import_wisdom(const std::string & filename)
+{
+    // rank 0 reads the file and the wisdom is broadcast to all processes
+    int rank;
+    int found = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) found = FFTW(import_wisdom_from_filename)(filename.c_str());
+
+    MPI_Bcast(&found, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (found) FFTW(mpi_broadcast_wisdom)(MPI_COMM_WORLD);
+
+    return found;
+}
+
+void export_wisdom(const std::string & filename)
+{
+    // the wisdom of all processes is gathered on rank 0 and written to file
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    FFTW(mpi_gather_wisdom)(MPI_COMM_WORLD);
+
+    if (rank == 0 && !FFTW(export_wisdom_to_filename)(filename.c_str()))
+        fprintf(stderr, "Could not write fftw wisdom to %s\n", filename.c_str());
+}
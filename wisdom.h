@@ -0,0 +1,13 @@
+
+#ifndef WISDOM_H
+#define WISDOM_H
+
+#include "precision.h"
+#include <string>
+
+unsigned planner_flags(const std::string & planner);
+std::string wisdom_filename(const std::string & dir, int Nx, int Ny, int np, int nthreads, const std::string & planner);
+bool import_wisdom(const std::string & filename);
+void export_wisdom(const std::string & filename);
+
+#endif